@@ -12,10 +12,12 @@
 #include "HDSPeConf.h"
 
 #define SET_CB(prop) card->prop.callOnValueChange(POSTCB(update_##prop,#prop))
+#define SET_MASK_CB(prop) card->prop.callOnChannelChange(POSTMASKCB(update_##prop,#prop))
 
 class MyAESPanel: public AESPanel {
  protected:
   class AESCard* card { nullptr };
+  RefreshBatcher refresh;   //!< Coalesces control value change updates.
 
   constexpr static const double UNSET_PITCH { -1.0 };
   double newPitch = UNSET_PITCH;
@@ -25,7 +27,7 @@ class MyAESPanel: public AESPanel {
     : AESPanel(parent, wxID_ANY)
     , card(_card)
   {
-    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild));
+    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild.load(0)));
     
     SET_CB(running);
     SET_CB(bufferSize);
@@ -33,8 +35,8 @@ class MyAESPanel: public AESPanel {
     SET_CB(internalFreq);
     SET_CB(preferredRef);
     SET_CB(syncRef);
-    SET_CB(syncStatus);
-    SET_CB(syncFreq);
+    SET_MASK_CB(syncStatus);
+    SET_MASK_CB(syncFreq);
     SET_CB(sampleRate);
     
     SET_CB(doubleSpeedMode);
@@ -48,16 +50,16 @@ class MyAESPanel: public AESPanel {
 
   void update_running(void)
   {
-    internalFreqLabel->Show(card->running);
+    internalFreqLabel->Show(card->running.load(0));
     internalFreqLabel->SetLabelText(card->internalFreq.label());
     
-    internalFreqChoice->Show(!card->running);
-    internalFreqChoice->SetSelection(card->internalFreq.value());    
+    internalFreqChoice->Show(!card->running.load(0));
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));    
   }
 
   void update_bufferSize(void)
   {
-    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize));
+    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize.load(0)));
   }
 
   void update_clockMode(void)
@@ -79,33 +81,31 @@ class MyAESPanel: public AESPanel {
   void update_internalFreq(void)
   {
     internalFreqLabel->SetLabelText(card->internalFreq.label());
-    internalFreqChoice->SetSelection(card->internalFreq.value());
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));
     
     checkFreqs();
   }
   
-  void update_syncFreq(void)
-  {
-    wclkFreqLabel->SetLabelText(card->syncFreq.label(0));
-    aes1FreqLabel->SetLabelText(card->syncFreq.label(1));
-    aes2FreqLabel->SetLabelText(card->syncFreq.label(2));
-    aes3FreqLabel->SetLabelText(card->syncFreq.label(3));
-    aes4FreqLabel->SetLabelText(card->syncFreq.label(4));    
-    aes5FreqLabel->SetLabelText(card->syncFreq.label(5));
-    aes6FreqLabel->SetLabelText(card->syncFreq.label(6));
-    aes7FreqLabel->SetLabelText(card->syncFreq.label(7));
-    aes8FreqLabel->SetLabelText(card->syncFreq.label(8));    
-    tcoFreqLabel->SetLabelText(card->syncFreq.label(9));
-    syncInFreqLabel->SetLabelText(card->syncFreq.label(10));
-    
-    checkFreqs();
+  // Only the sync inputs whose bit is set in mask are updated.
+  void update_syncFreq(uint64_t mask)
+  {
+    wxStaticText* labels[] = {
+      wclkFreqLabel, aes1FreqLabel, aes2FreqLabel, aes3FreqLabel,
+      aes4FreqLabel, aes5FreqLabel, aes6FreqLabel, aes7FreqLabel,
+      aes8FreqLabel, tcoFreqLabel, syncInFreqLabel
+    };
+    for (unsigned i=0; i<11; i++)
+      if (mask & SndControl::channelBit(i))
+	labels[i]->SetLabelText(card->syncFreq.label(i));
+
+    checkFreqs(mask);
   }
 
   void update_sampleRate(void)
   {
-    int rate = (int)round(card->getSystemSampleRate());
-    sampleRateLabel->SetLabelText(std::to_string(rate));
-    sampleRateLabel->SetBackgroundColour(card->isStandardSampleRate(rate)
+    SampleRate rate = card->getSystemRate();
+    sampleRateLabel->SetLabelText(std::to_string(rate.round()));
+    sampleRateLabel->SetBackgroundColour(rate.isStandard()
 					 ? wxNullColour : wxColour(0xff, 0xc6, 0x00));
 
     pitchSlider->Enable(card->isMaster());
@@ -137,7 +137,7 @@ class MyAESPanel: public AESPanel {
     masterButton->SetValue(card->isMaster());
     
     if (!card->isMaster()) {
-      switch (card->preferredRef) {
+      switch (card->preferredRef.load(0)) {
       case 0: wclkSyncButton->SetValue(true); break;
       case 1: aes1SyncButton->SetValue(true); break;
       case 2: aes2SyncButton->SetValue(true); break;	
@@ -153,80 +153,71 @@ class MyAESPanel: public AESPanel {
     }
   }
 
-  void checkFreqs(void)
+  void checkFreqs(uint64_t mask =~0ULL)
   {
     internalWarn->Show(card->internalRateDeviates());
 
-    unsigned* f = card->syncFreq.values();
-    wclkWarn->Show(!card->isClockCompatible(f[0]));
-    aes1Warn->Show(!card->isClockCompatible(f[1]));
-    aes2Warn->Show(!card->isClockCompatible(f[2]));    
-    aes3Warn->Show(!card->isClockCompatible(f[3]));
-    aes4Warn->Show(!card->isClockCompatible(f[4]));    
-    aes5Warn->Show(!card->isClockCompatible(f[5]));
-    aes6Warn->Show(!card->isClockCompatible(f[6]));    
-    aes7Warn->Show(!card->isClockCompatible(f[7]));
-    aes8Warn->Show(!card->isClockCompatible(f[8]));    
-    tcoWarn->Show(!card->isClockCompatible(f[9]));
-    syncInWarn->Show(!card->isClockCompatible(f[10]));
-  }
-
-  void enableSyncButtons(void)
-  {
-    unsigned* s = card->syncStatus.values();
-    wclkSyncButton->Enable(s[0] != 3);
-    aes1SyncButton->Enable(s[1] != 3);
-    aes2SyncButton->Enable(s[2] != 3);    
-    aes3SyncButton->Enable(s[3] != 3);
-    aes4SyncButton->Enable(s[4] != 3);    
-    aes5SyncButton->Enable(s[5] != 3);
-    aes6SyncButton->Enable(s[6] != 3);    
-    aes7SyncButton->Enable(s[7] != 3);
-    aes8SyncButton->Enable(s[8] != 3);    
-    tcoSyncButton->Enable(s[9] != 3);
-    syncInSyncButton->Enable(s[10] != 3);    
-  }
-
-  void update_syncStatus(void)
-  {
-    wclkStatusLabel->SetLabelText(card->syncStatus.label(0));
-    aes1StatusLabel->SetLabelText(card->syncStatus.label(1));
-    aes2StatusLabel->SetLabelText(card->syncStatus.label(2));    
-    aes3StatusLabel->SetLabelText(card->syncStatus.label(3));
-    aes4StatusLabel->SetLabelText(card->syncStatus.label(4));    
-    aes5StatusLabel->SetLabelText(card->syncStatus.label(5));
-    aes6StatusLabel->SetLabelText(card->syncStatus.label(6));    
-    aes7StatusLabel->SetLabelText(card->syncStatus.label(7));
-    aes8StatusLabel->SetLabelText(card->syncStatus.label(8));    
-    tcoStatusLabel->SetLabelText(card->syncStatus.label(9));
-    syncInStatusLabel->SetLabelText(card->syncStatus.label(10));
-    
-    enableSyncButtons();
+    wxStaticBitmap* warns[] = {
+      wclkWarn, aes1Warn, aes2Warn, aes3Warn, aes4Warn, aes5Warn,
+      aes6Warn, aes7Warn, aes8Warn, tcoWarn, syncInWarn
+    };
+    const std::vector<unsigned> f = card->syncFreq.load();
+    for (unsigned i=0; i<11; i++)
+      if (mask & SndControl::channelBit(i))
+	warns[i]->Show(!card->isClockCompatible(f[i]));
+  }
+
+  void enableSyncButtons(uint64_t mask =~0ULL)
+  {
+    wxRadioButton* buttons[] = {
+      wclkSyncButton, aes1SyncButton, aes2SyncButton, aes3SyncButton,
+      aes4SyncButton, aes5SyncButton, aes6SyncButton, aes7SyncButton,
+      aes8SyncButton, tcoSyncButton, syncInSyncButton
+    };
+    const std::vector<unsigned> s = card->syncStatus.load();
+    for (unsigned i=0; i<11; i++)
+      if (mask & SndControl::channelBit(i))
+	buttons[i]->Enable(s[i] != 3);
+  }
+
+  // Only the sync inputs whose bit is set in mask are updated.
+  void update_syncStatus(uint64_t mask)
+  {
+    wxStaticText* labels[] = {
+      wclkStatusLabel, aes1StatusLabel, aes2StatusLabel, aes3StatusLabel,
+      aes4StatusLabel, aes5StatusLabel, aes6StatusLabel, aes7StatusLabel,
+      aes8StatusLabel, tcoStatusLabel, syncInStatusLabel
+    };
+    for (unsigned i=0; i<11; i++)
+      if (mask & SndControl::channelBit(i))
+	labels[i]->SetLabelText(card->syncStatus.label(i));
+
+    enableSyncButtons(mask);
   }
 
   void update_doubleSpeedMode(void)
   {
-    dsModeBox->SetSelection(card->doubleSpeedMode);
+    dsModeBox->SetSelection(card->doubleSpeedMode.load(0));
   }
 
   void update_quadSpeedMode(void)
   {
-    qsModeBox->SetSelection(card->quadSpeedMode);
+    qsModeBox->SetSelection(card->quadSpeedMode.load(0));
   }
 
   void update_professional(void)
   {
-    professionalButton->SetValue(card->professional);
+    professionalButton->SetValue(card->professional.load(0));
   }
 
   void update_emphasis(void)
   {
-    emphasisButton->SetValue(card->emphasis);
+    emphasisButton->SetValue(card->emphasis.load(0));
   }
 
   void update_nonAudio(void)
   {
-    nonAudioButton->SetValue(card->nonAudio);
+    nonAudioButton->SetValue(card->nonAudio.load(0));
   }
 
   void update_singleSpeedWclkOut(void)
@@ -236,13 +227,13 @@ class MyAESPanel: public AESPanel {
       singleSpeedWclkButton->SetValue(true);
     } else {
       singleSpeedWclkButton->Enable();
-      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut);
+      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut.load(0));
     }
   }
 
   void update_clrTms(void)
   {
-    tmsButton->SetValue(!card->clrTms);
+    tmsButton->SetValue(!card->clrTms.load(0));
   }
 
   void internalFreqCB(wxCommandEvent &event) override
@@ -387,8 +378,8 @@ class MyAESPanel: public AESPanel {
   }
 };
 
-AESCard::AESCard(int index)
-  : HDSPeCard(index)
+AESCard::AESCard(const std::string& cardName)
+  : HDSPeCard(cardName)
   , doubleSpeedMode(this, "Double Speed Mode")
   , quadSpeedMode(this, "Quad Speed Mode")
   , professional(this, "Professional")
@@ -401,6 +392,19 @@ AESCard::AESCard(int index)
   tcoSyncChoice = 9;
 }
 
+std::vector<std::pair<const char*, SndControl*>> AESCard::getModelControls(void)
+{
+  return {
+    { "doubleSpeedMode", &doubleSpeedMode },
+    { "quadSpeedMode", &quadSpeedMode },
+    { "professional", &professional },
+    { "emphasis", &emphasis },
+    { "nonAudio", &nonAudio },
+    { "singleSpeedWclkOut", &singleSpeedWclkOut },
+    { "clrTms", &clrTms }
+  };
+}
+
 AESCard::~AESCard()
 {
 }
@@ -19,9 +19,11 @@ class AESCard: public HDSPeCard {
   SndBoolControl nonAudio;
   SndBoolControl singleSpeedWclkOut;
   SndBoolControl clrTms;
+
+  std::vector<std::pair<const char*, SndControl*>> getModelControls(void) override;
   
  public:
-  AESCard(int index);
+  AESCard(const std::string& cardName);
   ~AESCard();
 
   class wxPanel* makePanel(class wxWindow* parent) override;
@@ -16,6 +16,7 @@
 class MyAioPanel: public AioPanel {
  protected:
   class AioCard* card { nullptr };
+  RefreshBatcher refresh;   //!< Coalesces control value change updates.
 
   constexpr static const double UNSET_PITCH { -1.0 };
   double newPitch = UNSET_PITCH;
@@ -25,10 +26,10 @@ class MyAioPanel: public AioPanel {
     : AioPanel(parent, wxID_ANY)
     , card(_card)
   {
-    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild));
-    ao4sButton->SetValue(card->ao4s);
-    ai4sButton->SetValue(card->ai4s);
-    tcoButton->SetValue(card->tcoPresent);
+    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild.load(0)));
+    ao4sButton->SetValue(card->ao4s.load(0));
+    ai4sButton->SetValue(card->ai4s.load(0));
+    tcoButton->SetValue(card->tcoPresent.load(0));
     
     SET_CB(running);
     SET_CB(bufferSize);
@@ -54,16 +55,16 @@ class MyAioPanel: public AioPanel {
 
   void update_running(void)
   {
-    internalFreqLabel->Show(card->running);
+    internalFreqLabel->Show(card->running.load(0));
     internalFreqLabel->SetLabelText(card->internalFreq.label());
     
-    internalFreqChoice->Show(!card->running);
-    internalFreqChoice->SetSelection(card->internalFreq.value());    
+    internalFreqChoice->Show(!card->running.load(0));
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));    
   }
 
   void update_bufferSize(void)
   {
-    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize));
+    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize.load(0)));
   }
 
   void update_clockMode(void)
@@ -85,7 +86,7 @@ class MyAioPanel: public AioPanel {
   void update_internalFreq(void)
   {
     internalFreqLabel->SetLabelText(card->internalFreq.label());
-    internalFreqChoice->SetSelection(card->internalFreq.value());
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));
     
     checkFreqs();
   }
@@ -104,9 +105,9 @@ class MyAioPanel: public AioPanel {
 
   void update_sampleRate(void)
   {
-    int rate = (int)round(card->getSystemSampleRate());
-    sampleRateLabel->SetLabelText(std::to_string(rate));
-    sampleRateLabel->SetBackgroundColour(card->isStandardSampleRate(rate)
+    SampleRate rate = card->getSystemRate();
+    sampleRateLabel->SetLabelText(std::to_string(rate.round()));
+    sampleRateLabel->SetBackgroundColour(rate.isStandard()
 					 ? wxNullColour : wxColour(0xff, 0xc6, 0x00));
 
     pitchSlider->Enable(card->isMaster());
@@ -117,7 +118,7 @@ class MyAioPanel: public AioPanel {
 
   void update_adatInternal(void)
   {
-    adatInternalButton->SetValue(card->adatInternal);
+    adatInternalButton->SetValue(card->adatInternal.load(0));
   }
 
   void setClockSourceLabel(void)
@@ -138,7 +139,7 @@ class MyAioPanel: public AioPanel {
     masterButton->SetValue(card->isMaster());
     
     if (!card->isMaster()) {
-      switch (card->preferredRef) {
+      switch (card->preferredRef.load(0)) {
       case 0: wclkSyncButton->SetValue(true); break;
       case 1: aesSyncButton->SetValue(true); break;
       case 2: spdifSyncButton->SetValue(true); break;
@@ -153,7 +154,7 @@ class MyAioPanel: public AioPanel {
   {
     internalWarn->Show(card->internalRateDeviates());
 
-    unsigned* f = card->syncFreq.values();
+    const std::vector<unsigned> f = card->syncFreq.load();
     wclkWarn->Show(!card->isClockCompatible(f[0]));
     aesWarn->Show(!card->isClockCompatible(f[1]));
     spdifWarn->Show(!card->isClockCompatible(f[2]));
@@ -164,7 +165,7 @@ class MyAioPanel: public AioPanel {
 
   void enableSyncButtons(void)
   {
-    unsigned* s = card->syncStatus.values();
+    const std::vector<unsigned> s = card->syncStatus.load();
     wclkSyncButton->Enable(s[0] != 3);
     aesSyncButton->Enable(s[1] != 3);
     spdifSyncButton->Enable(s[2] != 3);
@@ -187,38 +188,38 @@ class MyAioPanel: public AioPanel {
   
   void update_inputLevel(void)
   {
-    inputLevelBox->SetSelection(card->inputLevel);
+    inputLevelBox->SetSelection(card->inputLevel.load(0));
   }
 
   void update_outputLevel(void)
   {
-    outputLevelBox->SetSelection(card->outputLevel);
+    outputLevelBox->SetSelection(card->outputLevel.load(0));
   }
 
   void update_xlr(void)
   {
     // 1 - level because the buttons are declared bottom-to-top
-    analogOutBox->SetSelection(1 - card->xlr);
+    analogOutBox->SetSelection(1 - card->xlr.load(0));
   }
 
   void update_phonesLevel(void)
   {
-    phonesLevelBox->SetSelection(card->phonesLevel);
+    phonesLevelBox->SetSelection(card->phonesLevel.load(0));
   }
 
   void update_spdifIn(void)
   {
-    spdifInBox->SetSelection(card->spdifIn);
+    spdifInBox->SetSelection(card->spdifIn.load(0));
   }
 
   void update_spdifOpt(void)
   {
-    spdifOpticalButton->SetValue(card->spdifOpt);
+    spdifOpticalButton->SetValue(card->spdifOpt.load(0));
   }
 
   void update_spdifPro(void)
   {
-    spdifProButton->SetValue(card->spdifPro);
+    spdifProButton->SetValue(card->spdifPro.load(0));
   }
 
   void update_singleSpeedWclkOut(void)
@@ -228,13 +229,13 @@ class MyAioPanel: public AioPanel {
       singleSpeedWclkButton->SetValue(true);
     } else {
       singleSpeedWclkButton->Enable();
-      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut);
+      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut.load(0));
     }
   }
 
   void update_clrTms(void)
   {
-    tmsButton->SetValue(!card->clrTms);
+    tmsButton->SetValue(!card->clrTms.load(0));
   }
 
   void internalFreqCB(wxCommandEvent &event) override
@@ -364,8 +365,8 @@ class MyAioPanel: public AioPanel {
   }
 };
 
-AioCard::AioCard(int index)
-  : HDSPeCard(index)
+AioCard::AioCard(const std::string& cardName)
+  : HDSPeCard(cardName)
   , inputLevel(this, "Input Level")
   , outputLevel(this, "Output Level")
   , phonesLevel(this, "Phones Level")
@@ -383,6 +384,24 @@ AioCard::AioCard(int index)
   tcoSyncChoice = 4;
 }
 
+std::vector<std::pair<const char*, SndControl*>> AioCard::getModelControls(void)
+{
+  return {
+    { "inputLevel", &inputLevel },
+    { "outputLevel", &outputLevel },
+    { "phonesLevel", &phonesLevel },
+    { "spdifIn", &spdifIn },
+    { "spdifOpt", &spdifOpt },
+    { "spdifPro", &spdifPro },
+    { "singleSpeedWclkOut", &singleSpeedWclkOut },
+    { "clrTms", &clrTms },
+    { "xlr", &xlr },
+    { "ai4s", &ai4s },
+    { "ao4s", &ao4s },
+    { "adatInternal", &adatInternal }
+  };
+}
+
 AioCard::~AioCard()
 {
 }
@@ -25,8 +25,10 @@ class AioCard: public HDSPeCard {
   SndBoolControl ao4s;
   SndBoolControl adatInternal;
 
+  std::vector<std::pair<const char*, SndControl*>> getModelControls(void) override;
+
 public:
-  AioCard(int index);
+  AioCard(const std::string& cardName);
   ~AioCard();
 
   class wxPanel* makePanel(class wxWindow* parent) override;
@@ -16,6 +16,7 @@
 class MyAioProPanel: public AioProPanel {
  protected:
   class AioProCard* card { nullptr };
+  RefreshBatcher refresh;   //!< Coalesces control value change updates.
 
   constexpr static const double UNSET_PITCH { -1.0 };
   double newPitch = UNSET_PITCH;
@@ -25,7 +26,7 @@ class MyAioProPanel: public AioProPanel {
     : AioProPanel(parent, wxID_ANY)
     , card(_card)
   {
-    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild));
+    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild.load(0)));
     
     SET_CB(running);
     SET_CB(bufferSize);
@@ -49,16 +50,16 @@ class MyAioProPanel: public AioProPanel {
 
   void update_running(void)
   {
-    internalFreqLabel->Show(card->running);
+    internalFreqLabel->Show(card->running.load(0));
     internalFreqLabel->SetLabelText(card->internalFreq.label());
     
-    internalFreqChoice->Show(!card->running);
-    internalFreqChoice->SetSelection(card->internalFreq.value());    
+    internalFreqChoice->Show(!card->running.load(0));
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));    
   }
 
   void update_bufferSize(void)
   {
-    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize));
+    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize.load(0)));
   }
 
   void update_clockMode(void)
@@ -80,7 +81,7 @@ class MyAioProPanel: public AioProPanel {
   void update_internalFreq(void)
   {
     internalFreqLabel->SetLabelText(card->internalFreq.label());
-    internalFreqChoice->SetSelection(card->internalFreq.value());
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));
     
     checkFreqs();
   }
@@ -99,9 +100,9 @@ class MyAioProPanel: public AioProPanel {
 
   void update_sampleRate(void)
   {
-    int rate = (int)round(card->getSystemSampleRate());
-    sampleRateLabel->SetLabelText(std::to_string(rate));
-    sampleRateLabel->SetBackgroundColour(card->isStandardSampleRate(rate)
+    SampleRate rate = card->getSystemRate();
+    sampleRateLabel->SetLabelText(std::to_string(rate.round()));
+    sampleRateLabel->SetBackgroundColour(rate.isStandard()
 					 ? wxNullColour : wxColour(0xff, 0xc6, 0x00));
 
     pitchSlider->Enable(card->isMaster());
@@ -128,7 +129,7 @@ class MyAioProPanel: public AioProPanel {
     masterButton->SetValue(card->isMaster());
     
     if (!card->isMaster()) {
-      switch (card->preferredRef) {
+      switch (card->preferredRef.load(0)) {
       case 0: wclkSyncButton->SetValue(true); break;
       case 1: aesSyncButton->SetValue(true); break;
       case 2: spdifSyncButton->SetValue(true); break;
@@ -143,7 +144,7 @@ class MyAioProPanel: public AioProPanel {
   {
     internalWarn->Show(card->internalRateDeviates());
 
-    unsigned* f = card->syncFreq.values();
+    const std::vector<unsigned> f = card->syncFreq.load();
     wclkWarn->Show(!card->isClockCompatible(f[0]));
     aesWarn->Show(!card->isClockCompatible(f[1]));
     spdifWarn->Show(!card->isClockCompatible(f[2]));
@@ -154,7 +155,7 @@ class MyAioProPanel: public AioProPanel {
 
   void enableSyncButtons(void)
   {
-    unsigned* s = card->syncStatus.values();
+    const std::vector<unsigned> s = card->syncStatus.load();
     wclkSyncButton->Enable(s[0] != 3);
     aesSyncButton->Enable(s[1] != 3);
     spdifSyncButton->Enable(s[2] != 3);
@@ -178,7 +179,7 @@ class MyAioProPanel: public AioProPanel {
   void update_inputLevel(void)
   {
     // 3 - level because the buttons are declared bottom-to-top.
-    inputLevelBox->SetSelection(3 - card->inputLevel);
+    inputLevelBox->SetSelection(3 - card->inputLevel.load(0));
   }
 
   void update_outputLevel(void)
@@ -192,22 +193,22 @@ class MyAioProPanel: public AioProPanel {
 
   void update_phonesLevel(void)
   {
-    phonesLevelBox->SetSelection(1 - card->phonesLevel);
+    phonesLevelBox->SetSelection(1 - card->phonesLevel.load(0));
   }
 
   void update_spdifIn(void)
   {
-    spdifInBox->SetSelection(card->spdifIn);
+    spdifInBox->SetSelection(card->spdifIn.load(0));
   }
 
   void update_spdifOpt(void)
   {
-    spdifOpticalButton->SetValue(card->spdifOpt);
+    spdifOpticalButton->SetValue(card->spdifOpt.load(0));
   }
 
   void update_spdifPro(void)
   {
-    spdifProButton->SetValue(card->spdifPro);
+    spdifProButton->SetValue(card->spdifPro.load(0));
   }
 
   void update_singleSpeedWclkOut(void)
@@ -217,13 +218,13 @@ class MyAioProPanel: public AioProPanel {
       singleSpeedWclkButton->SetValue(true);
     } else {
       singleSpeedWclkButton->Enable();
-      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut);
+      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut.load(0));
     }
   }
 
   void update_clrTms(void)
   {
-    tmsButton->SetValue(!card->clrTms);
+    tmsButton->SetValue(!card->clrTms.load(0));
   }
 
   //! \brief Set output level radio box label texts depending on whether
@@ -371,8 +372,8 @@ class MyAioProPanel: public AioProPanel {
   }
 };
 
-AioProCard::AioProCard(int index)
-  : HDSPeCard(index)
+AioProCard::AioProCard(const std::string& cardName)
+  : HDSPeCard(cardName)
   , inputLevel(this, "Input Level")
   , outputLevel(this, "Output Level")
   , phonesLevel(this, "Phones Level")
@@ -386,6 +387,20 @@ AioProCard::AioProCard(int index)
   tcoSyncChoice = 4;
 }
 
+std::vector<std::pair<const char*, SndControl*>> AioProCard::getModelControls(void)
+{
+  return {
+    { "inputLevel", &inputLevel },
+    { "outputLevel", &outputLevel },
+    { "phonesLevel", &phonesLevel },
+    { "spdifIn", &spdifIn },
+    { "spdifOpt", &spdifOpt },
+    { "spdifPro", &spdifPro },
+    { "singleSpeedWclkOut", &singleSpeedWclkOut },
+    { "clrTms", &clrTms }
+  };
+}
+
 AioProCard::~AioProCard()
 {
 }
@@ -23,9 +23,11 @@ class AioProCard: public HDSPeCard {
 
   int outOnXlr(void) const;       // 1 if output on XLR, 0 if on RCA
   int getOutputLevel(void) const; // 0,1,2,3 - different meanings for XLR / RCA
+
+  std::vector<std::pair<const char*, SndControl*>> getModelControls(void) override;
   
  public:
-  AioProCard(int index);
+  AioProCard(const std::string& cardName);
   ~AioProCard();
 
   class wxPanel* makePanel(class wxWindow* parent) override;
@@ -4,11 +4,25 @@
  * - Philippe.Bekaert@uhasselt.be */
 
 #include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
 #include <stdexcept>
 #include <iostream>
 #include <string>
+#include <thread>
 
 #include "HDSPeCard.h"
+#include "SndTransaction.h"
 #include "AES.h"
 #include "Aio.h"
 #include "AioPro.h"
@@ -16,43 +30,263 @@
 #include "TCO.h"
 #include "MADI.h"
 
-HDSPeCardEnumerator::HDSPeCardEnumerator()
-{
+HDSPeCardEnumerator::HDSPeCardEnumerator(const std::vector<std::string>& extraCards,
+					 bool hotplug)
+{
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+
+  if (hotplug) {
+    // Open the uevent socket before enumerating, so no card can come or
+    // go unnoticed in between. Cards found twice are ignored.
+    ueventfd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    struct sockaddr_nl addr {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_pid = 0;     // let the kernel assign a port id.
+    addr.nl_groups = 1;  // kernel uevents.
+    if (ueventfd >= 0 && bind(ueventfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+      close(ueventfd);
+      ueventfd = -1;
+    }
+    if (ueventfd >= 0)
+      stopfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (ueventfd < 0 || stopfd < 0) {
+      std::cerr << "HDSPeCardEnumerator: hotplug monitoring not available: "
+		<< strerror(errno) << "\n";
+      if (ueventfd >= 0) close(ueventfd);
+      ueventfd = -1;
+    }
+  }
+
+  // ALSA name, long name of each card found.
+  std::vector<std::pair<std::string, std::string>> found;
   for (int i = -1; snd_card_next(&i) >= 0 && i >= 0; ) {
     char* name;
     snd_card_get_longname(i, &name);
     std::cout << "Card " << i << " : " << name << "\n";
+    found.emplace_back("hw:" + std::to_string(i), name);
+    free(name);
+  }
 
-    HDSPeCard* newcard {nullptr};
+  for (auto& cardName: extraCards) {
+    std::string name;
     try {
-      if (strncmp(name, "RME AIO Pro", strlen("RME AIO Pro")) == 0) {
-	newcard = new AioProCard(i);
-      }
-      else if (strncmp(name, "RME AIO", strlen("RME AIO")) == 0) {
-	newcard = new AioCard(i);
-      }
-      else if (strncmp(name, "RME RayDAT", strlen("RME RayDAT")) == 0) {
-	newcard = new RayDATCard(i);
-      }
-      else if (strncmp(name, "RME AES", strlen("RME AES")) == 0) {
-	newcard = new AESCard(i);
-      }
-      else if (strncmp(name, "RME MADI", strlen("RME MADI")) == 0) {
-	newcard = new MADICard(i);
-      }
+      name = SndCard(cardName).getLongName();
     } catch (std::runtime_error& e) {
       std::cerr << e.what() << "\n";
-      delete newcard; newcard = nullptr;
+      continue;
+    }
+    std::cout << "Card " << cardName << " : " << name << "\n";
+    found.emplace_back(cardName, name);
+  }
+
+  // Opening a card and loading its controls takes a number of driver
+  // round trips per control: do all cards at the same time.
+  std::vector<HDSPeCard*> made(found.size(), nullptr);
+  std::vector<std::string> errors(found.size());
+  std::vector<double> times(found.size(), 0.);
+  std::vector<std::thread> threads;
+  for (size_t i=0; i<found.size(); i++)
+    threads.emplace_back([&found, &made, &errors, &times, i]() {
+	Clock::time_point t0 = Clock::now();
+	made[i] = create(found[i].first, found[i].second, errors[i]);
+	times[i] = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+      });
+  for (auto& t: threads)
+    t.join();
+
+  // Report and keep the cards in enumeration order.
+  for (size_t i=0; i<found.size(); i++) {
+    if (!errors[i].empty())
+      std::cerr << errors[i] << "\n";
+    if (made[i]) {
+      std::cout << "Card " << found[i].first << " : ready in "
+		<< times[i] << " ms\n";
+      cards.emplace_back(made[i]);
+      startupTimes.push_back(times[i]);
+    }
+  }
+  std::cout << cards.size() << " HDSPe card(s) ready in "
+	    << std::chrono::duration<double, std::milli>(Clock::now() - start).count()
+	    << " ms\n";
+
+  if (ueventfd >= 0)
+    hotplugThread = std::thread([this](){ hotplugMain(); });
+}
+
+Subscription HDSPeCardEnumerator::subscribeCards(CardCallback cb)
+{
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  if (cb)
+    for (auto& card: cards)
+      cb(card, true);
+  return cardSubscribers.add(cb);
+}
+
+void HDSPeCardEnumerator::hotplugMain(void)
+{
+  char buf[8192];
+  for (;;) {
+    struct pollfd pfds[2] {
+      { stopfd, POLLIN, 0 },
+      { ueventfd, POLLIN, 0 }
+    };
+    int n = poll(pfds, 2, -1);
+    if (n < 0) {
+      if (errno == EINTR)
+	continue;
+      std::cerr << "HDSPeCardEnumerator: poll failed: " << strerror(errno) << "\n";
+      return;
+    }
+    if (pfds[0].revents)
+      return;
+    if (pfds[1].revents & POLLIN) {
+      ssize_t len = recv(ueventfd, buf, sizeof(buf)-1, MSG_DONTWAIT);
+      if (len > 0) {
+	buf[len] = '\0';
+	handleUevent(buf, len);
+      }
+    }
+  }
+}
+
+void HDSPeCardEnumerator::handleUevent(const char* msg, size_t len)
+{
+  // "<action>@<devpath>\0KEY=VALUE\0KEY=VALUE\0..."
+  std::string action, subsystem, devname;
+  for (const char* p = msg; p < msg + len; p += strlen(p) + 1) {
+    if (strncmp(p, "ACTION=", 7) == 0) action = p + 7;
+    else if (strncmp(p, "SUBSYSTEM=", 10) == 0) subsystem = p + 10;
+    else if (strncmp(p, "DEVNAME=", 8) == 0) devname = p + 8;
+  }
+
+  // Each card has exactly one control device, snd/controlC<index>.
+  static const char* control = "snd/controlC";
+  if (subsystem != "sound" || devname.compare(0, strlen(control), control) != 0)
+    return;
+  char* end = nullptr;
+  long index = strtol(devname.c_str() + strlen(control), &end, 10);
+  if (!end || *end != '\0' || index < 0)
+    return;
+
+  try {
+    if (action == "add")
+      cardAdded(index);
+    else if (action == "remove")
+      cardRemoved(index);
+  } catch (std::runtime_error& e) {
+    std::cerr << "HDSPeCardEnumerator: " << e.what() << "\n";
+  }
+}
+
+void HDSPeCardEnumerator::cardAdded(int index)
+{
+  const std::string cardName = "hw:" + std::to_string(index);
+  {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
+    for (auto& card: cards)
+      if (card->getName() == cardName)
+	return;
+  }
+
+  // The kernel announces the device before udev has set its
+  // permissions: retry opening it for a while.
+  using Clock = std::chrono::steady_clock;
+  static const int maxTries { 20 }, retryMs { 100 };
+  HDSPeCard* newcard { nullptr };
+  std::string error;
+  double ms { 0. };
+  for (int i=0; i<maxTries; i++) {
+    char* name { nullptr };
+    if (snd_card_get_longname(index, &name) >= 0) {
+      std::string longName(name);
+      free(name);
+      error.clear();
+      Clock::time_point t0 = Clock::now();
+      newcard = create(cardName, longName, error);
+      ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+      if (newcard || error.empty())
+	break;  // HDSPe card created, or not a HDSPe card.
+    }
+    struct pollfd pfd { stopfd, POLLIN, 0 };
+    if (poll(&pfd, 1, retryMs) > 0)
+      return;   // shutting down.
+  }
+  if (!newcard) {
+    if (!error.empty())
+      std::cerr << error << "\n";
+    return;
+  }
+
+  std::cout << "Card " << cardName << " : " << newcard->getLongName()
+	    << " added, ready in " << ms << " ms\n";
+  std::shared_ptr<HDSPeCard> card(newcard);
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  cards.push_back(card);
+  startupTimes.push_back(ms);
+  cardSubscribers.call(card, true);
+}
+
+void HDSPeCardEnumerator::cardRemoved(int index)
+{
+  const std::string cardName = "hw:" + std::to_string(index);
+  std::shared_ptr<HDSPeCard> card;
+  {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
+    for (size_t i=0; i<cards.size(); i++) {
+      if (cards[i]->getName() != cardName)
+	continue;
+      card = cards[i];
+      cards.erase(cards.begin() + i);
+      startupTimes.erase(startupTimes.begin() + i);
+      cardSubscribers.call(card, false);
+      break;
+    }
+  }
+  if (card)
+    std::cout << "Card " << cardName << " : removed\n";
+  // card is deleted here, unless a subscriber still holds it.
+}
+
+HDSPeCard* HDSPeCardEnumerator::create(const std::string& cardName,
+				       const std::string& longName,
+				       std::string& error)
+{
+  const char* name = longName.c_str();
+  HDSPeCard* newcard {nullptr};
+  try {
+    if (strncmp(name, "RME AIO Pro", strlen("RME AIO Pro")) == 0) {
+      newcard = new AioProCard(cardName);
+    }
+    else if (strncmp(name, "RME AIO", strlen("RME AIO")) == 0) {
+      newcard = new AioCard(cardName);
+    }
+    else if (strncmp(name, "RME RayDAT", strlen("RME RayDAT")) == 0) {
+      newcard = new RayDATCard(cardName);
+    }
+    else if (strncmp(name, "RME AES", strlen("RME AES")) == 0) {
+      newcard = new AESCard(cardName);
     }
-    if (newcard)
-      cards.push_back(newcard);
+    else if (strncmp(name, "RME MADI", strlen("RME MADI")) == 0) {
+      newcard = new MADICard(cardName);
+    }
+  } catch (std::runtime_error& e) {
+    error = e.what();
+    delete newcard; newcard = nullptr;
   }
+  return newcard;
 }
 
 HDSPeCardEnumerator::~HDSPeCardEnumerator()
 {
-  for (auto card: cards)
-    delete card;
+  if (hotplugThread.joinable()) {
+    uint64_t one = 1;
+    if (write(stopfd, &one, sizeof(one)) < 0)
+      std::cerr << "HDSPeCardEnumerator: eventfd write failed.\n";
+    hotplugThread.join();
+  }
+  if (stopfd >= 0) close(stopfd);
+  if (ueventfd >= 0) close(ueventfd);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -64,8 +298,8 @@ HDSPeCard::DriverCheck::DriverCheck(SndCard* card)
 			     + " is not a HDSPe driven card.\n");
 }
 
-HDSPeCard::HDSPeCard(int index)
-  : SndCard      (index)
+HDSPeCard::HDSPeCard(const std::string& cardName)
+  : SndCard      (cardName)
   , driverCheck  (this)
   , statusPolling(this, "Status Polling")
   , cardRevision (this, "Card Revision")
@@ -82,29 +316,198 @@ HDSPeCard::HDSPeCard(int index)
   , syncFreq     (this, "AutoSync Frequency")
   , sampleRate   (this, "Raw Sample Rate", SndControl::HWDEP)
   , dds          (this, "DDS", SndControl::HWDEP)
+  , ddsWriter    (dds, 50.)
 {
-  if (tcoPresent)
-    tco = new HDSPeTCO(this);
+  // Simulated cards are private to the process.
+  if (getName().compare(0, 3, "hw:") == 0) {
+    pollRegistry.reset(new StatusPollRegistry(serial));
+    if (!pollRegistry->available())
+      pollRegistry.reset();
+  }
+
+  for (SndControl* c: std::initializer_list<SndControl*> { &sampleRate, &dds })
+    rateSubs.push_back(c->subscribeValueChange([this](){ updateRates(); }));
+  // The sample rate does not change on a stable clock: make sure the
+  // cached rates reflect the current values before the card is used.
+  updateRates();
 
+  lastTransition = std::chrono::steady_clock::now();
   statusPolling.callOnValueChange([this](){ onStatusChange(); });
-  statusPolling.set(statusPollFreq);
+  for (SndControl* c: std::initializer_list<SndControl*>
+	 { &syncRef, &syncStatus, &syncFreq })
+    transitionSubs.push_back(c->subscribeValueChange([this](){ onSyncTransition(); }));
+  pollThread = std::thread([this](){ pollThreadMain(); });
 }
 
 HDSPeCard::~HDSPeCard()
 {
+  rateSubs.clear();
+  transitionSubs.clear();
+  {
+    std::lock_guard<std::mutex> lock(pollMtx);
+    pollStop = true;
+  }
+  pollCond.notify_all();
+  pollThread.join();
   statusPolling.callOnValueChange(nullptr);
   delete tco;
 }
 
+HDSPeTCO* HDSPeCard::getTco(void)
+{
+  std::lock_guard<std::mutex> lock(tcoMtx);
+  if (!tco && tcoPresent)
+    tco = new HDSPeTCO(this);
+  return tco;
+}
+
+HDSPeTCO* HDSPeCard::getLoadedTco(void)
+{
+  std::lock_guard<std::mutex> lock(tcoMtx);
+  return tco;
+}
+
+int HDSPeStatusPollPolicy::rate(double t) const
+{
+  if (t < holdTime || fastRate <= slowRate)
+    return fastRate;
+  double r = slowRate + (fastRate - slowRate) * exp(-(t - holdTime) / decayTime);
+  return std::max(slowRate, (int)ceil(r - 0.5));
+}
+
+void HDSPeCard::kickPollThread(void)
+{
+  {
+    std::lock_guard<std::mutex> lock(pollMtx);
+    pollRearm = true;
+  }
+  pollCond.notify_all();
+}
+
 void HDSPeCard::onStatusChange(void)
 {
-  //  std::cerr << __func__ << ":" << __LINE__ << ": statusPolling=" << statusPolling << ", statusPollFreq=" << statusPollFreq << "\n";
-  if (statusPolling < statusPollFreq) {
-    // Driver deactivates status polling after detecting a change.
-    // Re-enable it. Or if other applications want to poll at a different
-    // rate, take the maximum of their desired rate and ours.
-    statusPolling.set(statusPollFreq);
+  // Driver deactivates status polling after detecting a change.
+  // Re-enable it, on the pollThread: statusPolling is locked here.
+  kickPollThread();
+}
+
+void HDSPeCard::onSyncTransition(void)
+{
+  // Runs with a sync status control locked: never touch statusPolling
+  // here, the pollThread raises the rate.
+  {
+    std::lock_guard<std::mutex> lock(pollMtx);
+    lastTransition = std::chrono::steady_clock::now();
+  }
+  kickPollThread();
+}
+
+void HDSPeCard::rearmStatusPolling(void)
+{
+  // Never call statusPolling.set() with pollMtx held: it takes the
+  // statusPolling lock, which the event thread holds while calling
+  // onStatusChange(), which takes pollMtx.
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point now = Clock::now();
+  int rate, set;
+  {
+    std::lock_guard<std::mutex> lock(pollMtx);
+    rate = pollPolicy.rate(std::chrono::duration<double>(now - lastTransition).count());
+    set = pollRateSet;
+  }
+  int cur = statusPolling.load(0);
+
+  // Other hdspeconf processes on this card: only the elected writer
+  // writes, the maximum rate of all. Others write only to raise the rate
+  // beyond what the writer wants itself, e.g. after a policy change, or
+  // if the writer fails to re-arm polling at our rate for pollGraceMs.
+  int target = rate;
+  bool writer = true, starved = false;
+  if (pollRegistry) {
+    pollRegistry->setRate(rate);
+    writer = pollRegistry->isWriter();
+    if (writer)
+      target = pollRegistry->maxRate();
+    else
+      starved = cur < rate;
+  }
+
+  // The writer follows the rates of the others down as they decay.
+  bool follow = pollRegistry && writer && target > rate;
+  bool graceOver = false;
+  {
+    std::lock_guard<std::mutex> lock(pollMtx);
+    if (starved && !pollStarved)
+      pollStarvedSince = now;
+    pollStarved = starved;
+    pollFollowing = follow;
+    graceOver = starved
+      && now - pollStarvedSince >= std::chrono::milliseconds(pollGraceMs);
+  }
+
+  if (!writer && !graceOver
+      && (rate <= cur || rate <= pollRegistry->writerRate()))
+    return;
+
+  // The elected writer owns the control: it lowers any higher rate to
+  // the maximum rate registered, whoever set it. Acting alone, take the
+  // maximum of the rate other applications want and ours: only lower our
+  // own rate.
+  bool lower = pollRegistry && writer ? cur > target : cur > target && cur == set;
+  if (cur < target || lower) {
+    statusPolling.set(target);
+    std::lock_guard<std::mutex> lock(pollMtx);
+    pollRateSet = target;
+  }
+}
+
+void HDSPeCard::pollThreadMain(void)
+{
+  std::unique_lock<std::mutex> lock(pollMtx);
+  while (!pollStop) {
+    pollRearm = false;
+    lock.unlock();
+    try {
+      rearmStatusPolling();
+    } catch (std::runtime_error& e) {
+      std::cerr << e.what();
+    }
+    lock.lock();
+
+    // Re-evaluate every 0.5 seconds while decaying, while waiting for
+    // the writer to re-arm polling, or while following the decaying rates
+    // of other processes. Once stable, sleep until the next re-arm
+    // request: a status change, transition or policy change.
+    double t = std::chrono::duration<double>
+      (std::chrono::steady_clock::now() - lastTransition).count();
+    auto asked = [this](){ return pollStop || pollRearm; };
+    if (pollPolicy.rate(t) <= pollPolicy.slowRate && !pollStarved && !pollFollowing)
+      pollCond.wait(lock, asked);
+    else
+      pollCond.wait_for(lock, std::chrono::milliseconds(500), asked);
+  }
+}
+
+void HDSPeCard::setStatusPollPolicy(const HDSPeStatusPollPolicy& policy)
+{
+  {
+    std::lock_guard<std::mutex> lock(pollMtx);
+    pollPolicy = policy;
+    long lo, hi, step;
+    statusPolling.getRange(&lo, &hi, &step);
+    pollPolicy.fastRate = std::min(hi, std::max(lo, (long)policy.fastRate));
+    pollPolicy.slowRate = std::min(hi, std::max(lo, (long)policy.slowRate));
+    pollPolicy.slowRate = std::max(1, pollPolicy.slowRate);
+    if (pollPolicy.decayTime <= 0.) pollPolicy.decayTime = 1e-3;
+    pollRearm = true;
   }
+  pollCond.notify_all();
+}
+
+HDSPeStatusPollPolicy HDSPeCard::getStatusPollPolicy(void)
+{
+  std::lock_guard<std::mutex> lock(pollMtx);
+  return pollPolicy;
 }
 
 const std::string HDSPeCard::getPrettyName(void) const
@@ -112,16 +515,101 @@ const std::string HDSPeCard::getPrettyName(void) const
   return modelName + " (" + std::to_string(serial) + ")";
 }
 
+// Value of the first channel of a boolean, integer or enumerated control.
+static long long firstValue(SndControl* c)
+{
+  if (auto b = dynamic_cast<SndBoolControl*>(c))  return b->load(0);
+  if (auto i = dynamic_cast<SndIntControl*>(c))   return i->load(0);
+  if (auto l = dynamic_cast<SndInt64Control*>(c)) return l->load(0);
+  if (auto e = dynamic_cast<SndEnumControl*>(c))  return e->load(0);
+  return 0;
+}
+
+void HDSPeCard::snapshot(HDSPeSnapshot& s, bool refresh)
+{
+  auto model = getModelControls();
+
+  std::vector<SndControl*> controls {
+    &serial, &fwBuild, &running, &bufferSize, &tcoPresent,
+    &clockMode, &internalFreq, &preferredRef, &syncRef,
+    &syncStatus, &syncFreq, &sampleRate, &dds
+  };
+  for (auto& m: model)
+    controls.push_back(m.second);
+  HDSPeTCO* tco = getLoadedTco();
+  if (tco) {
+    controls.insert(controls.end(), {
+	&tco->lock, &tco->syncSrc, &tco->ltcInValid, &tco->ltcIn,
+	&tco->ltcInFps, &tco->ltcInDropFrame, &tco->videoFormat,
+	&tco->wckValid, &tco->wckSpeed });
+  }
+
+  if (refresh)
+    for (auto c: controls)
+      if (c->isReadable()) c->read();
+
+  // load() each control: lock-free for all controls here, so neither
+  // the event handling thread nor a writer ever waits for a snapshot.
+  memset(&s, 0, sizeof(s));
+  clock_gettime(CLOCK_MONOTONIC, &s.time);
+
+  s.serial = serial.load(0);
+  s.fwBuild = fwBuild.load(0);
+  s.running = running.load(0);
+  s.bufferSize = bufferSize.load(0);
+  s.clockMode = clockMode.load(0);
+  s.internalFreq = internalFreq.load(0);
+  s.preferredRef = preferredRef.load(0);
+  s.syncRef = syncRef.load(0);
+  const std::vector<unsigned> status = syncStatus.load();
+  const std::vector<unsigned> freq = syncFreq.load();
+  s.nrSources = std::min((unsigned)status.size(), HDSPeSnapshot::maxSources);
+  for (unsigned i=0; i<s.nrSources; i++) {
+    s.syncStatus[i] = status[i];
+    s.syncFreq[i] = i < freq.size() ? freq[i] : 0;
+  }
+  const std::vector<long long> rate = sampleRate.load();
+  s.sampleRate[0] = rate.size() > 0 ? rate[0] : 0;
+  s.sampleRate[1] = rate.size() > 1 ? rate[1] : 0;
+  s.dds = dds.load(0);
+  s.systemSampleRate = SampleRate(s.sampleRate[0], s.sampleRate[1]).toDouble();
+
+  s.nrModelFields = std::min((unsigned)model.size(),
+			     HDSPeSnapshot::maxModelFields);
+  for (unsigned i=0; i<s.nrModelFields; i++) {
+    snprintf(s.model[i].name, sizeof(s.model[i].name), "%s", model[i].first);
+    s.model[i].value = firstValue(model[i].second);
+  }
+
+  s.tcoPresent = tcoPresent.load(0);
+  s.tcoLoaded = tco != nullptr;
+  if (tco) {
+    s.tcoLock = tco->lock.load(0);
+    s.tcoSyncSrc = tco->syncSrc.load(0);
+    s.ltcInValid = tco->ltcInValid.load(0);
+    const std::vector<long long> ltc = tco->ltcIn.load();
+    s.ltcIn = ltc[0];
+    s.ltcInFrameCount = ltc.size() > 1 ? ltc[1] : 0;
+    s.ltcInFps = tco->ltcInFps.load(0);
+    s.ltcInDropFrame = tco->ltcInDropFrame.load(0);
+    s.videoFormat = tco->videoFormat.load(0);
+    s.wckValid = tco->wckValid.load(0);
+    s.wckSpeed = tco->wckSpeed.load(0);
+  }
+}
+
 bool HDSPeCard::hasTco(void) const
 {
-  return tcoPresent;
+  return tcoPresent.load(0);
 }
 
 void HDSPeCard::syncToTco(int enable)
 {
-  if (enable && tcoPresent) {
-    preferredRef.set(tcoSyncChoice);
-    clockMode.set(0);
+  if (enable && tcoPresent.load(0)) {
+    SndTransaction t;
+    t.set(preferredRef, tcoSyncChoice);
+    t.set(clockMode, 0);
+    t.commit();
   } else if (!enable) {
     clockMode.set(1);
   }
@@ -129,11 +617,12 @@ void HDSPeCard::syncToTco(int enable)
 
 bool HDSPeCard::isSyncedToTco(void)
 {
-  return !isMaster() && ((int)preferredRef == tcoSyncChoice);
+  return !isMaster() && ((int)preferredRef.load(0) == tcoSyncChoice);
 }
 
 class wxPanel* HDSPeCard::makeTcoPanel(class wxWindow* parent)
 {
+  HDSPeTCO* tco = getTco();
   return tco ? new MyTCOPanel(tco, parent) : nullptr;
 }
 
@@ -196,43 +685,67 @@ bool HDSPeCard::singleSpeedRateDeviates(double rate, double ref)
 
 bool HDSPeCard::isRunning(void) const
 {
-  return running != 0;
+  return running.load(0) != 0;
 }
 
 bool HDSPeCard::isMaster(void) const
 {
-  return clockMode != 0;
+  return clockMode.load(0) != 0;
 }
 
 int HDSPeCard::getExternalFreq(void) const
 {
-  return syncRef < syncFreq.getCount() ? syncFreq[syncRef] : 0;
+  unsigned ref = syncRef.load(0);
+  return ref < syncFreq.getCount() ? syncFreq.load(ref) : 0;
 }
 
 int HDSPeCard::getReferenceSampleRate(void) const
 {
-  return freqRate(isMaster() || syncRef >= syncFreq.getCount() /* "Intern" */
-		  ? internalFreq+1 : getExternalFreq());
+  return freqRate(isMaster() || syncRef.load(0) >= syncFreq.getCount() /* "Intern" */
+		  ? internalFreq.load(0)+1 : getExternalFreq());
+}
+
+void HDSPeCard::updateRates(void)
+{
+  // numerator and denominator from the same read.
+  const std::vector<long long> r = sampleRate.load();
+  const long d = dds.load(0);
+  std::lock_guard<std::mutex> lock(rateMtx);
+  systemRate = r.size() >= 2 ? SampleRate(r[0], r[1]) : SampleRate();
+  internalRate = r.size() >= 1 ? SampleRate(r[0], d) : SampleRate();
+}
+
+SampleRate HDSPeCard::getSystemRate(void) const
+{
+  std::lock_guard<std::mutex> lock(rateMtx);
+  return systemRate;
+}
+
+SampleRate HDSPeCard::getInternalRate(void) const
+{
+  std::lock_guard<std::mutex> lock(rateMtx);
+  return internalRate;
 }
 
 double HDSPeCard::getSystemSampleRate(void) const
 {
-  return (double)sampleRate[0] / (double)sampleRate[1];
+  return getSystemRate().toDouble();
 }
 
 double HDSPeCard::getInternalSampleRate(void) const
 {
-  return (double)sampleRate[0] / (double)dds;
+  return getInternalRate().toDouble();
 }
 
 bool HDSPeCard::internalRateDeviates(void) const
 {
-  return sampleRateDeviates(getInternalSampleRate(), getSystemSampleRate());
+  return getInternalRate().deviates(getSystemRate());
 }
 
 bool HDSPeCard::isClockCompatible(unsigned freq) const
 {
-  return !singleSpeedRateDeviates(freqRate(freq), getSystemSampleRate());
+  SampleRate rate(freqRate(freq));
+  return !rate.singleSpeed().deviates(getSystemRate().singleSpeed());
 }
 
 double HDSPeCard::getPitch(double rate, double ref)
@@ -249,25 +762,32 @@ double HDSPeCard::getPitch(double rate) const
 
 double HDSPeCard::getPitch(void) const
 {
-  return getPitch(getSystemSampleRate());
+  return getSystemRate().singleSpeed()
+    .pitch(SampleRate(getReferenceSampleRate()).singleSpeed());
 }
 
 void HDSPeCard::setPitch(double pitch)
 {
-  double desiredRate = (double)freqRate(internalFreq+1) * (1.0 + pitch);
-  dds.set((double)sampleRate[0] / desiredRate);
+  double desiredRate = (double)freqRate(internalFreq.load(0)+1) * (1.0 + pitch);
+  ddsWriter.set((double)sampleRate.load(0) / desiredRate);
+}
+
+SampleRate HDSPeCard::getTargetRate(void) const
+{
+  long d;
+  if (ddsWriter.getPending(d))
+    return SampleRate(sampleRate.load(0), d);
+  return getSystemRate();
 }
 
 double HDSPeCard::upPitch(void)
 {
-  double rate = round(getSystemSampleRate()) + 1.0;
-  return getPitch(rate);
+  return getPitch((double)(getTargetRate().round() + 1));
 }
 
 double HDSPeCard::downPitch(void)
 {
-  double rate = round(getSystemSampleRate()) - 1.0;
-  return getPitch(rate);
+  return getPitch((double)(getTargetRate().round() - 1));
 }
 
 static double pitchTab[5] = {
@@ -300,14 +820,20 @@ static double getPrevPitch(double pitch)
   return newpitch;
 }
 
+// Pitch of the target rate: the rate of the last setPitch().
+static double getTargetPitch(const SampleRate& target, int ref)
+{
+  return target.singleSpeed().pitch(SampleRate(ref).singleSpeed());
+}
+
 double HDSPeCard::nextPitch(void)
 {
-  return getNextPitch(getPitch());
+  return getNextPitch(getTargetPitch(getTargetRate(), getReferenceSampleRate()));
 }
 
 double HDSPeCard::prevPitch(void)
 {
-  return getPrevPitch(getPitch());  
+  return getPrevPitch(getTargetPitch(getTargetRate(), getReferenceSampleRate()));
 }
 
 HDSPeTCO::HDSPeTCO(HDSPeCard* _card)
@@ -333,25 +859,56 @@ HDSPeTCO::HDSPeTCO(HDSPeCard* _card)
   , syncSrc       (_card, "TCO Sync Source")
   , wordTerm      (_card, "TCO WordClk Term")
 {
+  ltcIn.callOnValueChange([this](){ onLtcIn(); });
 }
 
 HDSPeTCO::~HDSPeTCO()
 {
+  ltcIn.callOnValueChange(nullptr);
+}
+
+void HDSPeTCO::onLtcIn(void)
+{
+  // Runs on the control event thread with ltcIn locked. Nobody pops
+  // the frames without a subscriber.
+  if (ltcFrameSubscribers.empty())
+    return;
+  HDSPeLtcFrame frame;
+  clock_gettime(CLOCK_MONOTONIC, &frame.time);
+  frame.ltc = ltcIn[0];
+  frame.frameCount = ltcIn.getCount() > 1 ? ltcIn[1] : 0;
+  ltcFrameSubscribers.call(frame);
+}
+
+Subscription HDSPeTCO::subscribeLtcFrame(LtcFrameRing& ring, SndControl::Callback cb)
+{
+  Subscription sub = ltcFrameSubscribers.add([&ring, cb](const HDSPeLtcFrame& frame) {
+      ring.push(frame);
+      if (cb) cb();
+    });
+  if (cb) cb();
+  return sub;
 }
 
 void HDSPeTCO::getFrameRate(int *fps, int *df)
 {
   static int fpss[6] = { 0, 1, 2, 2, 3, 3 };
   static int dfs[6]  = { 0, 0, 0, 1, 0, 1 };
-  if (frameRate > 6)
+  unsigned fr = frameRate.load(0);
+  if (fr >= 6)
     throw std::runtime_error("Unrecognized TCO frame rate value "
-			     + std::to_string(frameRate) + ".\n");
-  *fps = fpss[frameRate];
-  *df = dfs[frameRate];
+			     + std::to_string(fr) + ".\n");
+  *fps = fpss[fr];
+  *df = dfs[fr];
+}
+
+unsigned HDSPeTCO::frameRateItem(int fps, int df)
+{
+  static const unsigned fr[8] = { 0, 1, 2, 4,   0, 1, 3, 5 };
+  return fr[4*df + fps];
 }
 
 void HDSPeTCO::setFrameRate(int fps, int df)
 {
-  int fr[8] = { 0, 1, 2, 4,   0, 1, 3, 5 };
-  frameRate.set(fr[4*df + fps]);
+  frameRate.set(frameRateItem(fps, df));
 }
@@ -5,38 +5,187 @@
 #ifndef _HDSPE_CARD_H_
 #define _HDSPE_CARD_H_
 
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include <time.h>
+
 #include "SndCard.h"
 #include "SndControl.h"
-
-//! \brief Enumerates RME HDSPe cards on the system at construction time.
+#include "RingBuffer.h"
+#include "SndCoalescingWriter.h"
+#include "SubscriberList.h"
+#include "StatusPollRegistry.h"
+#include "SampleRate.h"
+
+//! \brief Enumerates RME HDSPe cards on the system at construction time,
+//! and keeps the list up to date as cards come and go.
 //! Get the number of cards and pointers to the HDSPeCard object representing
 //! each card after.
+//!
+//! The HDSPeCard objects are constructed concurrently, one thread per card,
+//! so startup time does not grow with the number of cards. The time each
+//! card took is reported on std::cout, and available from getStartupTime().
+//!
+//! A hotplug thread watches the kernel uevent netlink socket for sound card
+//! control devices being added or removed, e.g. when the driver is
+//! (re)loaded, and creates or drops the HDSPeCard object accordingly.
+//! subscribeCards() callbacks are notified. Cards are shared: a removed
+//! card is deleted, closing its ALSA handles, as soon as the last
+//! std::shared_ptr to it is released. Hold a reference for as long as
+//! you use a card. Extra cards, e.g. simulated ones, are not affected.
 class HDSPeCardEnumerator {
+ public:
+  //! \brief Card list change callback: card was added (added true) or
+  //! removed (added false).
+  using CardCallback = std::function<void(std::shared_ptr<class HDSPeCard> card, bool added)>;
+
  protected:
-  std::vector<class HDSPeCard*> cards; //!< List of HDSPe cards on system.
-  
+  mutable std::recursive_mutex mtx;    //!< Protects cards and startupTimes.
+  std::vector<std::shared_ptr<class HDSPeCard>> cards; //!< List of HDSPe cards on system.
+  std::vector<double> startupTimes;    //!< Construction time of each card, in ms.
+  SubscriberList<CardCallback> cardSubscribers; //!< Card list change callbacks.
+
+  int ueventfd { -1 };                 //!< Kernel uevent netlink socket.
+  int stopfd { -1 };                   //!< eventfd, signaled for hotplug thread shutdown.
+  std::thread hotplugThread;           //!< Handles uevents.
+
+  //! \brief Create the HDSPeCard object for the card with given ALSA name
+  //! and long name, if it is a HDSPe card model we know. Returns nullptr
+  //! otherwise, or if construction fails, with the reason in error.
+  static HDSPeCard* create(const std::string& cardName,
+			   const std::string& longName,
+			   std::string& error);
+
+  //! \brief Hotplug thread main loop.
+  void hotplugMain(void);
+
+  //! \brief Handle a uevent message of len bytes.
+  void handleUevent(const char* msg, size_t len);
+
+  //! \brief Create the card with given ALSA index, if not yet there, and
+  //! notify subscribers.
+  void cardAdded(int index);
+
+  //! \brief Drop the card with given ALSA index, if there, and notify
+  //! subscribers.
+  void cardRemoved(int index);
+
  public:
-  //! \brief Constructor: enumerated HDSPe driven cards on system.
-  HDSPeCardEnumerator();
+  //! \brief Constructor: enumerated HDSPe driven cards on system,
+  //! followed by the named extra cards, e.g. simulated cards
+  //! (see HDSPeSimCard). Starts the hotplug thread if hotplug is true.
+  HDSPeCardEnumerator(const std::vector<std::string>& extraCards ={},
+		      bool hotplug =true);
 
   //! \brief Destructor.
   ~HDSPeCardEnumerator();
 
   //! \brief Get the number of HDSPe cards on the system.
-  int getCount(void) { return cards.size(); }
+  int getCount(void) const
+  {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
+    return cards.size();
+  }
 
   //! \brief Get the i-th HDSPe card on the system.
-  HDSPeCard* getCard(int i)
+  std::shared_ptr<HDSPeCard> getCard(int i) const
+  {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
+    return i<0 || i>=(int)cards.size() ? nullptr : cards[i];
+  }
+
+  //! \brief Get all HDSPe cards on the system, at the time of the call.
+  std::vector<std::shared_ptr<class HDSPeCard>> getCards(void) const
+  {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
+    return cards;
+  }
+
+  //! \brief Get the time it took to construct the i-th HDSPe card, in
+  //! milliseconds.
+  double getStartupTime(int i) const
   {
-    return i<0 || i>(int)cards.size() ? nullptr : cards[i];
+    std::lock_guard<std::recursive_mutex> lock(mtx);
+    return i<0 || i>=(int)startupTimes.size() ? 0. : startupTimes[i];
   }
 
-  //! \brief Get all HDSPe cards on the system.
-  std::vector<class HDSPeCard*>& getCards(void) { return cards; }
+  //! \brief Add a card list change callback. cb is removed when the
+  //! returned Subscription is destroyed. cb is called right away, from
+  //! the current thread, for each card present, as if it were added.
+  //! Later calls are from the hotplug thread. Card list changes and the
+  //! notification of them are atomic: no card is reported twice or
+  //! missed.
+  Subscription subscribeCards(CardCallback cb);
+};
+
+//! \brief Plain snapshot of HDSPe card status, as taken by
+//! HDSPeCard::snapshot(). Enumerated controls are reported as item index.
+struct HDSPeSnapshot {
+  static const unsigned maxSources { 16 };     //!< Max. nr of AutoSync sources.
+  static const unsigned maxModelFields { 16 }; //!< Max. nr of model specific fields.
+
+  struct timespec time;         //!< CLOCK_MONOTONIC time of the snapshot.
+
+  long serial;
+  long fwBuild;
+  int running;
+  long bufferSize;
+  unsigned clockMode;
+  unsigned internalFreq;
+  unsigned preferredRef;
+  unsigned syncRef;
+  unsigned nrSources;           //!< Number of valid syncStatus/syncFreq entries.
+  unsigned syncStatus[maxSources];
+  unsigned syncFreq[maxSources];
+  long long sampleRate[2];      //!< System sample rate numerator/denominator.
+  long dds;
+  double systemSampleRate;      //!< sampleRate[0] / sampleRate[1].
+
+  //! Model specific status: name/value pairs.
+  unsigned nrModelFields;
+  struct {
+    char name[32];
+    long long value;
+  } model[maxModelFields];
+
+  int tcoPresent;
+  int tcoLoaded;                //!< TCO controls loaded, see HDSPeCard::getTco().
+  // TCO status, valid if tcoLoaded.
+  int tcoLock;
+  unsigned tcoSyncSrc;
+  int ltcInValid;
+  long long ltcIn;              //!< BCD encoded LTC time code.
+  long long ltcInFrameCount;    //!< Frame count at last LTC time code.
+  unsigned ltcInFps;
+  int ltcInDropFrame;
+  unsigned videoFormat;
+  int wckValid;
+  unsigned wckSpeed;
+};
+
+//! \brief Driver status polling rate policy, see
+//! HDSPeCard::setStatusPollPolicy().
+//!
+//! The poll rate is fastRate for holdTime seconds after the last sync
+//! status transition, to catch settling quickly. It then decays
+//! exponentially, with time constant decayTime seconds, to slowRate.
+struct HDSPeStatusPollPolicy {
+  int fastRate { 50 };       //!< Polls per second right after a transition.
+  int slowRate { 2 };        //!< Polls per second when status is stable.
+  double holdTime { 3. };    //!< Seconds at fastRate after a transition.
+  double decayTime { 5. };   //!< Decay time constant, in seconds.
+
+  //! \brief Poll rate t seconds after the last transition.
+  int rate(double t) const;
 };
 
 //! \brief RME HDSPe sound card representation.
@@ -44,12 +193,19 @@ class HDSPeCard: public SndCard {
  protected:
   std::string modelName;  //!< Card model name
   int tcoSyncChoice {-1}; //!< preferred sync choice for TCO, -1 if no TCO
+
+  //! \brief Model specific controls to include in snapshots, with their
+  //! field name. Boolean, integer and enumerated controls only.
+  virtual std::vector<std::pair<const char*, SndControl*>> getModelControls(void)
+  {
+    return {};
+  }
   
  public:
-  //! \brief Constructor. Index is ALSA sound card index of the card to
-  //! be opened. Properties are read during construction. Status polling
-  //! is enabled.
-  HDSPeCard(int index);
+  //! \brief Constructor. cardName is the ALSA name of the card to
+  //! be opened, e.g. "hw:0". Properties are read during construction.
+  //! Status polling is enabled.
+  HDSPeCard(const std::string& cardName);
 
   //! \brief Destructor.
   virtual ~HDSPeCard();
@@ -58,6 +214,27 @@ class HDSPeCard: public SndCard {
   //! settings panel.
   const std::string getPrettyName(void) const;
 
+  //! \brief Return the card model name: AES, AIO, AIO Pro, MADI or RayDAT.
+  const std::string& getModelName(void) const { return modelName; }
+
+  //! \brief Set the driver status polling rate policy. Rates are clamped
+  //! to the range of the "Status Polling" control. Applies right away.
+  void setStatusPollPolicy(const HDSPeStatusPollPolicy& policy);
+
+  //! \brief Get the driver status polling rate policy.
+  HDSPeStatusPollPolicy getStatusPollPolicy(void);
+
+  //! \brief Fill s with the current status of the card and its TCO.
+  //! The TCO status is only included if the TCO controls were loaded
+  //! before, by getTco(): snapshot() does not load them.
+  //!
+  //! Values are taken from the control value caches, which the control
+  //! event handling thread keeps up to date, with SndAnyControl::load(),
+  //! without taking any lock. The snapshot thus never shows a control half
+  //! updated, and costs no driver access. If refresh is true, all controls
+  //! are re-read from the driver first.
+  void snapshot(HDSPeSnapshot& s, bool refresh =false);
+
   //! \brief Create a settings panel for the card.
   virtual class wxPanel* makePanel(class wxWindow* parent) =0;
 
@@ -81,6 +258,14 @@ class HDSPeCard: public SndCard {
   //! \brief Card in master clock mode?
   bool isMaster(void) const;
 
+  //! \brief Return the effective current card sample rate, exact
+  //! (measured w.r.t. the cards own clock).
+  SampleRate getSystemRate(void) const;
+
+  //! \brief Return internal sample rate (combination of frequency
+  //! class and internal pich), exact.
+  SampleRate getInternalRate(void) const;
+
   //! \brief Return the effective current card sample rate, to sub-Hz
   //! accuracy (measured w.r.t. the cards own clock).
   double getSystemSampleRate(void) const;
@@ -145,6 +330,9 @@ class HDSPeCard: public SndCard {
   // \brief Set internal pitch:
   void setPitch(double pitch);
 
+  // The pitch steps below start from the rate of the last setPitch(),
+  // also if it is not written yet, so repeated steps accumulate.
+
   //! \brief Up 1 Hz
   double upPitch(void);
 
@@ -171,11 +359,55 @@ class HDSPeCard: public SndCard {
   // effectively disabling it and causing our <onStatusChange> callback
   // to be invoked, as well as any registered callback of card status
   // properties that did change. The latter cause panel display updates on
-  // their turn. Our <onStatusChange> callback re-enables status polling
-  // whenever the driver disabled it, for as long as this program runs.
+  // their turn. Our <onStatusChange> callback has the pollThread re-enable
+  // status polling whenever the driver disabled it, for as long as this
+  // program runs. The rate follows pollPolicy: a sync status transition
+  // raises it at once, and the pollThread lowers it step by step while
+  // status is stable. The callbacks run with their control locked: they
+  // only wake the pollThread, which writes statusPolling without holding
+  // any other control lock (see Locking in SndControl.h).
   SndIntControl statusPolling;
   void onStatusChange(void);
-  static const int statusPollFreq { 10 };  // driver status poll frequency  
+  void onSyncTransition(void);
+
+  //! \brief Set statusPolling to the rate the policy asks for now, if it
+  //! is lower, or if it is higher and was set by us. With other processes
+  //! using the card, the pollRegistry decides who writes what: the
+  //! elected writer sets the maximum rate of all, also lowering it.
+  //! Called on the pollThread only.
+  void rearmStatusPolling(void);
+
+  //! \brief Have the pollThread call rearmStatusPolling() as soon as
+  //! possible.
+  void kickPollThread(void);
+
+  //! \brief Re-arms polling when asked, and lowers the poll rate while
+  //! status is stable.
+  void pollThreadMain(void);
+
+  std::mutex pollMtx;                 //!< Protects the members below.
+  std::condition_variable pollCond;   //!< Signals transitions, policy changes, stop.
+  HDSPeStatusPollPolicy pollPolicy;
+  std::chrono::steady_clock::time_point lastTransition; //!< Last sync status transition.
+  int pollRateSet { 0 };              //!< Rate last written by us.
+  bool pollStarved { false };         //!< Polling below our rate, set by another process' writer.
+  std::chrono::steady_clock::time_point pollStarvedSince; //!< Since when.
+  bool pollFollowing { false };       //!< Writing a higher rate wanted by another process.
+  static const int pollGraceMs { 1000 }; //!< Time the writer gets to re-arm polling.
+  bool pollRearm { false };           //!< Re-arm request for the pollThread.
+  bool pollStop { false };            //!< pollThread termination request.
+  std::thread pollThread;
+  std::vector<Subscription> transitionSubs; //!< Sync status value changes.
+  std::unique_ptr<StatusPollRegistry> pollRegistry; //!< Rates wanted by other processes. Null for non-hw cards.
+
+  // System and internal sample rate, recomputed by updateRates() on
+  // each sampleRate or dds value change only. updateRates() runs with
+  // either control locked, and load()s the other.
+  mutable std::mutex rateMtx;         //!< Protects systemRate and internalRate.
+  SampleRate systemRate;              //!< sampleRate numerator / denominator.
+  SampleRate internalRate;            //!< sampleRate numerator / dds.
+  std::vector<Subscription> rateSubs; //!< sampleRate and dds value changes.
+  void updateRates(void);
   
 public:
   // HDSPe card info
@@ -196,13 +428,47 @@ public:
   SndInt64Control sampleRate; //!< system sample rate as a ratio.
   SndIntControl dds;          //!< raw internal pitch control, denominator
                               //! of ratio with same numerator as sampleRate.
+  SndCoalescingWriter<long> ddsWriter; //!< Rate limited dds writes, for setPitch().
+
+  //! \brief System sample rate once the dds value pending in ddsWriter,
+  //! if any, is written. Else the current system sample rate.
+  SampleRate getTargetRate(void) const;
 
-  class HDSPeTCO* tco { nullptr };
+  //! \brief Returns the TCO module, or nullptr if there is none. The
+  //! HDSPeTCO object and its controls are created on first call.
+  class HDSPeTCO* getTco(void);
+
+  //! \brief Returns the TCO module if getTco() created it already,
+  //! nullptr otherwise.
+  class HDSPeTCO* getLoadedTco(void);
+
+ protected:
+  std::mutex tcoMtx;                 //!< Protects tco creation.
+  class HDSPeTCO* tco { nullptr };   //!< Created by getTco().
+};
+
+//! \brief LTC input frame, as received by the control event thread.
+struct HDSPeLtcFrame {
+  unsigned long long ltc { 0 };        //!< BCD encoded time code ("LTC In" value 0).
+  unsigned long long frameCount { 0 }; //!< Frame count ("LTC In" value 1).
+  struct timespec time { 0, 0 };       //!< CLOCK_MONOTONIC time of reception.
 };
 
 //! \brief TCO module status and controls.
+//!
+//! Every LTC In value change is queued, with a time stamp, by the control
+//! event thread in the ring buffer of each LTC frame subscriber, so a
+//! consumer can process all received frames even when it is not scheduled
+//! for a while. HDSPeTCO owns the ltcIn value change callback for that
+//! purpose: use subscribeLtcFrame() instead of ltcIn.callOnValueChange().
+//! Each subscriber, e.g. a TCO panel or a logger, pops the frames from a
+//! ring of its own. Without subscribers, as in daemon mode, no frames are
+//! queued at all.
 class HDSPeTCO {
 public:
+  //! \brief LTC input frame queue: about 2.5 seconds at 30 fps.
+  using LtcFrameRing = RingBuffer<HDSPeLtcFrame, 128>;
+
   HDSPeCard *card { nullptr };   //!< HDSPe card to which this TCO is connected.
 
   SndIntControl firmware;
@@ -225,7 +491,7 @@ public:
   SndEnumControl wckConversion;
   SndEnumControl syncSrc;
   SndBoolControl wordTerm;
-  
+
   //! \brief Constructor: loads properties for the TCO module on the card.
   HDSPeTCO(HDSPeCard* card);
 
@@ -236,9 +502,28 @@ public:
   //! per second and drop frame format in one.
   void setFrameRate(int fps, int df);
 
+  //! \brief frameRate property value for given LTC out frames per second
+  //! and drop frame format.
+  static unsigned frameRateItem(int fps, int df);
+
   //! \brief Get current LTC out fps and drop frame flag from frameRate
   //! property.
   void getFrameRate(int* fps, int *df);
+
+  //! \brief Queue each LTC input frame received from now on in ring,
+  //! and call cb after, on the control event thread. The subscriber is
+  //! the single consumer of ring, and pops its frames on one thread.
+  //! ring must outlive the returned Subscription. Queueing stops when the
+  //! Subscription is destroyed. Like SndControl subscriptions, cb is called
+  //! once right away.
+  Subscription subscribeLtcFrame(LtcFrameRing& ring, SndControl::Callback cb);
+
+protected:
+  SubscriberList<std::function<void(const HDSPeLtcFrame&)>> ltcFrameSubscribers;
+
+  //! \brief ltcIn value change callback: passes the frame to the
+  //! ltcFrameSubscribers, if any.
+  void onLtcIn(void);
 };
 
 #endif /* _HDSPE_CARD_H_ */
@@ -1,13 +1,117 @@
 /*! \file HDSPeConf.h
- *! \brief Global functions. 
+ *! \brief Global functions.
  * Philippe.Bekaert@uhasselt.be - 20210907,15,16 */
 
 #pragma once
 
 #include <sys/types.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 //! \brief Post a callback function.
 extern void PostCB(std::function<void(void)> cb);
 
-#define POSTCB(cb,prop) [this](){ PostCB([this](){ cb(); }); }
+//! \brief Coalesces the panel updates triggered by control value changes
+//! into a single posted refresh.
+//!
+//! add() returns a value change callback that only marks the given update
+//! function as pending. The first mark posts one refresh closure. Further
+//! marks, typically from the same event handling pass, are collected until
+//! that closure runs. The closure then runs each pending update function
+//! once, in the order they were added. The main loop thus sees at most one
+//! pending refresh per panel, no matter how many controls changed.
+//!
+//! addMasked() does the same for channel value change callbacks: the
+//! update function receives the union of the channel masks marked since
+//! it last ran.
+class RefreshBatcher {
+ protected:
+  struct State {
+    std::mutex mtx;
+    std::vector<std::function<void(uint64_t)>> updates; //!< GUI update functions.
+    std::vector<bool> dirty;                        //!< Pending updates.
+    std::vector<uint64_t> masks;                    //!< Pending channel masks.
+    bool posted { false };                          //!< Refresh posted?
+  };
+  std::shared_ptr<State> state { std::make_shared<State>() };
+
+  //! \brief Run pending updates. Called on the GUI thread.
+  static void refresh(const std::shared_ptr<State>& state)
+  {
+    std::vector<std::pair<size_t, uint64_t>> pending;
+    {
+      std::lock_guard<std::mutex> lock(state->mtx);
+      for (size_t i=0; i<state->dirty.size(); i++)
+	if (state->dirty[i]) {
+	  pending.emplace_back(i, state->masks[i]);
+	  state->dirty[i] = false;
+	  state->masks[i] = 0;
+	}
+      state->posted = false;
+    }
+    for (auto& p: pending)
+      if (p.first < state->updates.size())
+	state->updates[p.first](p.second);
+  }
+
+  //! \brief Mark update i pending with channel mask, posting a refresh if
+  //! none is pending yet.
+  static void mark(const std::shared_ptr<State>& state, size_t i, uint64_t mask)
+  {
+    bool post = false;
+    {
+      std::lock_guard<std::mutex> lock(state->mtx);
+      state->dirty[i] = true;
+      state->masks[i] |= mask;
+      if (!state->posted)
+	post = state->posted = true;
+    }
+    if (post)
+      PostCB([state](){ refresh(state); });
+  }
+
+ public:
+  //! \brief Destructor: pending refreshes no longer run any update.
+  ~RefreshBatcher()
+  {
+    std::lock_guard<std::mutex> lock(state->mtx);
+    state->updates.clear();
+  }
+
+  //! \brief Register GUI update function. Returns a callback marking it
+  //! pending, suited as control value change callback.
+  std::function<void(void)> add(std::function<void(void)> update)
+  {
+    std::shared_ptr<State> s = state;
+    size_t i = append([update](uint64_t){ update(); });
+    return [s,i](){ mark(s, i, 0); };
+  }
+
+  //! \brief Register GUI update function taking a channel mask. Returns a
+  //! callback marking it pending with the mask passed, suited as channel
+  //! value change callback.
+  std::function<void(uint64_t)> addMasked(std::function<void(uint64_t)> update)
+  {
+    std::shared_ptr<State> s = state;
+    size_t i = append(update);
+    return [s,i](uint64_t mask){ mark(s, i, mask); };
+  }
+
+ protected:
+  size_t append(std::function<void(uint64_t)> update)
+  {
+    std::lock_guard<std::mutex> lock(state->mtx);
+    size_t i = state->updates.size();
+    state->updates.push_back(update);
+    state->dirty.push_back(false);
+    state->masks.push_back(0);
+    return i;
+  }
+};
 
+#define POSTCB(cb,prop) refresh.add([this](){ cb(); })
+#define POSTMASKCB(cb,prop) refresh.addMasked([this](uint64_t mask){ cb(mask); })
@@ -0,0 +1,294 @@
+/*! \file HDSPeDaemon.cpp
+ *! \brief Headless hdspeconf: serves HDSPe card status on a UNIX socket.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "HDSPeDaemon.h"
+
+static void SysCheck(int rc, const char* what)
+{
+  if (rc < 0)
+    throw std::runtime_error("HDSPeDaemon: " + std::string(what) + " failed: "
+			     + std::string(strerror(errno)) + "\n");
+}
+
+sigset_t HDSPeDaemon::blockSignals(void)
+{
+  // SIGINT and SIGTERM are handled synchronously, through a signalfd.
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  SysCheck(pthread_sigmask(SIG_BLOCK, &mask, nullptr), "pthread_sigmask");
+  signal(SIGPIPE, SIG_IGN);
+  return mask;
+}
+
+const std::string HDSPeDaemon::defaultSocketPath(void)
+{
+  const char* dir = getenv("XDG_RUNTIME_DIR");
+  return std::string(dir ? dir : "/tmp") + "/hdspeconf.sock";
+}
+
+HDSPeDaemon::HDSPeDaemon(const std::string& path,
+			 const std::vector<std::string>& extraCards)
+  : cardEnumerator(extraCards)
+  , socketPath(path)
+{
+  struct sockaddr_un addr {};
+  addr.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(addr.sun_path))
+    throw std::runtime_error("HDSPeDaemon: socket path '" + socketPath
+			     + "' too long.\n");
+  strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path)-1);
+
+  // Only remove the socket of a previous run that died: nobody accepts
+  // connections on it anymore. Never take over from a running daemon.
+  int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  SysCheck(probe, "socket");
+  int rc = connect(probe, (struct sockaddr*)&addr, sizeof(addr));
+  int err = errno;
+  close(probe);
+  struct stat st;
+  if (rc == 0)
+    throw std::runtime_error("HDSPeDaemon: another daemon is serving on '"
+			     + socketPath + "'.\n");
+  if (err == ECONNREFUSED) {
+    if (lstat(socketPath.c_str(), &st) < 0 || !S_ISSOCK(st.st_mode))
+      throw std::runtime_error("HDSPeDaemon: '" + socketPath
+			       + "' is not a socket.\n");
+    unlink(socketPath.c_str());   // stale socket of previous run
+  } else if (err != ENOENT)
+    throw std::runtime_error("HDSPeDaemon: cannot use '" + socketPath
+			     + "': " + std::string(strerror(err)) + "\n");
+
+  listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  SysCheck(listenfd, "socket");
+  SysCheck(bind(listenfd, (struct sockaddr*)&addr, sizeof(addr)), "bind");
+  SysCheck(listen(listenfd, 8), "listen");
+
+  sigfd = signalfd(-1, &sigmask, SFD_CLOEXEC);
+  SysCheck(sigfd, "signalfd");
+
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  SysCheck(epfd, "epoll_create1");
+  struct epoll_event ev {};
+  ev.events = EPOLLIN;
+  ev.data.fd = listenfd;
+  SysCheck(epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev), "epoll_ctl");
+  ev.data.fd = sigfd;
+  SysCheck(epoll_ctl(epfd, EPOLL_CTL_ADD, sigfd, &ev), "epoll_ctl");
+
+  std::cout << "hdspeconf: serving " << cardEnumerator.getCount()
+	    << " card(s) on " << socketPath << "\n";
+}
+
+HDSPeDaemon::~HDSPeDaemon()
+{
+  while (!clients.empty())
+    drop(clients.begin()->first);
+  if (epfd >= 0) close(epfd);
+  if (sigfd >= 0) close(sigfd);
+  if (listenfd >= 0) {
+    close(listenfd);
+    unlink(socketPath.c_str());
+  }
+}
+
+int HDSPeDaemon::run(void)
+{
+  static const int maxevents = 16;
+  struct epoll_event events[maxevents];
+
+  for (;;) {
+    int n = epoll_wait(epfd, events, maxevents, -1);
+    if (n < 0 && errno == EINTR)
+      continue;
+    SysCheck(n, "epoll_wait");
+
+    for (int i=0; i<n; i++) {
+      int fd = events[i].data.fd;
+      if (fd == sigfd) {
+	std::cout << "hdspeconf: terminating.\n";
+	return 0;
+      } else if (fd == listenfd) {
+	accept();
+      } else if (!serve(fd)) {
+	drop(fd);
+      }
+    }
+  }
+}
+
+void HDSPeDaemon::accept(void)
+{
+  int fd = accept4(listenfd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+  if (fd < 0) {
+    if (errno != EAGAIN && errno != EINTR)
+      std::cerr << "HDSPeDaemon: accept failed: " << strerror(errno) << "\n";
+    return;
+  }
+
+  struct epoll_event ev {};
+  ev.events = EPOLLIN | EPOLLRDHUP;
+  ev.data.fd = fd;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    close(fd);
+    return;
+  }
+  clients[fd] = "";
+}
+
+void HDSPeDaemon::drop(int fd)
+{
+  epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  clients.erase(fd);
+}
+
+bool HDSPeDaemon::serve(int fd)
+{
+  std::string& input = clients[fd];
+
+  char buf[512];
+  ssize_t n = read(fd, buf, sizeof(buf));
+  if (n < 0)
+    return errno == EAGAIN || errno == EINTR;
+  if (n == 0)
+    return false;   // client closed the connection
+  input.append(buf, n);
+  if (input.size() > 4096)
+    return false;   // no sane request is that long
+
+  bool keep = true;
+  size_t eol;
+  while (keep && (eol = input.find('\n')) != std::string::npos) {
+    std::string request = input.substr(0, eol);
+    input.erase(0, eol+1);
+    if (!request.empty() && request.back() == '\r')
+      request.pop_back();
+
+    std::ostringstream response;
+    keep = handle(request, response);
+    if (keep)
+      response << ".\n";
+
+    // Responses are small. A client that does not read them is dropped.
+    const std::string out = response.str();
+    if (!out.empty() &&
+	send(fd, out.data(), out.size(), MSG_NOSIGNAL) != (ssize_t)out.size())
+      return false;
+  }
+  return keep;
+}
+
+bool HDSPeDaemon::handle(const std::string& request, std::ostream& s)
+{
+  std::istringstream r(request);
+  std::string command;
+  r >> command;
+
+  try {
+    if (command == "" ) {
+    } else if (command == "quit") {
+      return false;
+    } else if (command == "list") {
+      auto cards = cardEnumerator.getCards();
+      for (int i=0; i<(int)cards.size(); i++) {
+	auto& card = cards[i];
+	s << i << " " << card->getModelName() << " " << (long)card->serial.load(0)
+	  << " " << card->getPrettyName() << "\n";
+      }
+    } else if (command == "status") {
+      int i {-1};
+      std::string option;
+      if (!(r >> i) || !cardEnumerator.getCard(i))
+	s << "error no such card\n";
+      else if (r >> option && option != "tco")
+	s << "error unknown option '" << option << "'\n";
+      else
+	status(i, s, option == "tco");
+    } else {
+      s << "error unknown command '" << command << "'\n";
+    }
+  } catch (std::runtime_error& e) {
+    std::string msg(e.what());
+    while (!msg.empty() && msg.back() == '\n')
+      msg.pop_back();
+    s << "error " << msg << "\n";
+  }
+
+  return true;
+}
+
+// Writes the labels of the first n values in v of an enumerated control,
+// comma separated.
+static std::ostream& labels(std::ostream& s, const SndEnumControl& c,
+			    const unsigned* v, unsigned n)
+{
+  for (unsigned i=0; i<n; i++)
+    s << (i>0 ? "," : "") << c.getEnumLabel(v[i]);
+  return s;
+}
+
+void HDSPeDaemon::status(int i, std::ostream& s, bool withTco)
+{
+  std::shared_ptr<HDSPeCard> card = cardEnumerator.getCard(i);
+  if (!card)
+    throw std::runtime_error("no such card");
+  // snapshot() reports the TCO only once its controls are loaded.
+  HDSPeTCO* tco = withTco ? card->getTco() : nullptr;
+  HDSPeSnapshot snap;
+  card->snapshot(snap);
+
+  char rate[32];
+  snprintf(rate, sizeof(rate), "%.3f", snap.systemSampleRate);
+
+  s << "card=" << i << "\n"
+    << "model=" << card->getModelName() << "\n"
+    << "serial=" << snap.serial << "\n"
+    << "firmware=" << snap.fwBuild << "\n"
+    << "running=" << snap.running << "\n"
+    << "bufferSize=" << snap.bufferSize << "\n"
+    << "clockMode=" << card->clockMode.getEnumLabel(snap.clockMode) << "\n"
+    << "internalFreq=" << card->internalFreq.getEnumLabel(snap.internalFreq) << "\n"
+    << "preferredRef=" << card->preferredRef.getEnumLabel(snap.preferredRef) << "\n"
+    << "syncRef=" << card->syncRef.getEnumLabel(snap.syncRef) << "\n";
+  labels(s << "syncStatus=", card->syncStatus, snap.syncStatus, snap.nrSources) << "\n";
+  labels(s << "syncFreq=", card->syncFreq, snap.syncFreq, snap.nrSources) << "\n";
+  s << "sampleRate=" << rate << "\n";
+  for (unsigned m=0; m<snap.nrModelFields; m++)
+    s << "model." << snap.model[m].name << "=" << snap.model[m].value << "\n";
+  s << "tcoPresent=" << snap.tcoPresent << "\n";
+
+  if (tco && snap.tcoLoaded) {
+    unsigned long long ltc = snap.ltcIn;
+    char ltcbuf[20];
+    snprintf(ltcbuf, sizeof(ltcbuf), "%02llu:%02llu:%02llu:%02llu",
+	     ((ltc >> 56) & 0x03)*10 + ((ltc >> 48) & 0x0f),
+	     ((ltc >> 40) & 0x07)*10 + ((ltc >> 32) & 0x0f),
+	     ((ltc >> 24) & 0x07)*10 + ((ltc >> 16) & 0x0f),
+	     ((ltc >>  8) & 0x03)*10 + ((ltc >>  0) & 0x0f));
+    s << "tco.lock=" << snap.tcoLock << "\n"
+      << "tco.syncSrc=" << tco->syncSrc.getEnumLabel(snap.tcoSyncSrc) << "\n"
+      << "tco.ltcInValid=" << snap.ltcInValid << "\n"
+      << "tco.ltcIn=" << (snap.ltcInValid ? ltcbuf : "--:--:--:--") << "\n"
+      << "tco.wckValid=" << snap.wckValid << "\n";
+  }
+}
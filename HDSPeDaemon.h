@@ -0,0 +1,119 @@
+/*! \file HDSPeDaemon.h
+ *! \brief Headless hdspeconf: serves HDSPe card status on a UNIX socket.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+/*! \page daemonplusplus hdspeconf --daemon
+ *
+ * In daemon mode, hdspeconf enumerates the HDSPe cards as usual, but
+ * creates no windows. Instead, it listens on a local UNIX stream socket.
+ * Any number of monitoring clients can connect and query card status.
+ * Status is served from HDSPeCard::snapshot(), which copies the SndControl
+ * value caches in one consistent pass. The caches are kept up to date by
+ * the control event handling thread, so client queries do not cause
+ * driver access.
+ *
+ * Protocol
+ * --------
+ *
+ * Line based, plain text. Each request is a single line. Each response
+ * consists of zero or more lines, followed by a line with a single ".".
+ *
+ * - list : one line per card: "<card> <model> <serial> <pretty name>".
+ * - status <card> [tco] : one "key=value" line per status item of the
+ *   card. Model specific items are reported as "model.<name>=<value>".
+ *   With "tco", the status of the card's TCO module, if any, is included
+ *   as "tco.<name>=<value>". The TCO controls are loaded on first request.
+ * - quit : close the connection.
+ *
+ * Errors are reported as a single "error <message>" line, followed by ".".
+ *
+ * Cards added or removed while the daemon runs, e.g. by reloading the
+ * driver, are picked up without restart (see HDSPeCardEnumerator). Card
+ * numbers are positions in the current card list: issue "list" again
+ * after a change.
+ *
+ * Example:
+ *
+ *     $ hdspeconf --daemon &
+ *     $ socat - UNIX-CONNECT:$XDG_RUNTIME_DIR/hdspeconf.sock
+ *     status 0
+ *     card=0
+ *     model=AES
+ *     clockMode=Master
+ *     ...
+ *     .
+ */
+
+#ifndef _HDSPE_DAEMON_H_
+#define _HDSPE_DAEMON_H_
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+
+#include "HDSPeCard.h"
+
+//! \brief Headless hdspeconf: serves card status on a UNIX socket.
+//!
+//! See \ref daemonplusplus page.
+class HDSPeDaemon {
+ public:
+  //! \brief Blocks SIGINT and SIGTERM, so they are delivered to our
+  //! signalfd only. Returns the signal mask. Threads inherit the signal
+  //! mask when they are created: call this before starting any thread,
+  //! e.g. of a simulated card. The constructor calls it again.
+  static sigset_t blockSignals(void);
+
+ protected:
+  sigset_t sigmask { blockSignals() }; //!< Signals handled via sigfd.
+  HDSPeCardEnumerator cardEnumerator;  // enumerates HDSPe cards on construction
+
+  std::string socketPath;              //!< UNIX socket file name.
+  int listenfd { -1 };                 //!< Listening socket.
+  int sigfd { -1 };                    //!< signalfd for SIGINT and SIGTERM.
+  int epfd { -1 };                     //!< epoll instance.
+
+  std::map<int, std::string> clients;  //!< Connected clients, with pending input.
+
+  //! \brief Accept a new client connection.
+  void accept(void);
+
+  //! \brief Read and serve requests from client fd. Returns false if the
+  //! connection is to be closed.
+  bool serve(int fd);
+
+  //! \brief Handle a single request line, writing the response to s.
+  //! Returns false if the client asked to quit.
+  bool handle(const std::string& request, std::ostream& s);
+
+  //! \brief Write the status of the indicated card to s, and of its
+  //! TCO if withTco is true.
+  void status(int card, std::ostream& s, bool withTco);
+
+  //! \brief Close client connection fd.
+  void drop(int fd);
+
+ public:
+  //! \brief Default socket file name: $XDG_RUNTIME_DIR/hdspeconf.sock,
+  //! or /tmp/hdspeconf.sock if XDG_RUNTIME_DIR is not set.
+  static const std::string defaultSocketPath(void);
+
+  //! \brief Constructor: enumerates the cards, including the named extra
+  //! cards, and starts listening on the UNIX socket with given file name.
+  //! A socket file left behind by a daemon that died is replaced. Throws
+  //! std::runtime_error if another daemon is serving on it, or if the file
+  //! is no socket.
+  HDSPeDaemon(const std::string& socketPath =defaultSocketPath(),
+	      const std::vector<std::string>& extraCards ={});
+
+  //! \brief Destructor: closes all connections and removes the socket file.
+  ~HDSPeDaemon();
+
+  //! \brief Serve clients until SIGINT or SIGTERM. Returns exit code.
+  int run(void);
+};
+
+#endif /* _HDSPE_DAEMON_H_ */
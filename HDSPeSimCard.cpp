@@ -0,0 +1,206 @@
+/*! \file HDSPeSimCard.cpp
+ *! \brief Simulated RME HDSPe AES card, for running hdspeconf without
+ *! hardware.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#include <random>
+
+#include "HDSPeSimCard.h"
+#include "HDSPeCard.h"
+
+static const std::vector<std::string> freqLabels {
+  "32 KHz", "44.1 KHz", "48 KHz",
+  "64 KHz", "88.2 KHz", "96 KHz",
+  "128 KHz", "176.4 KHz", "192 KHz"
+};
+
+static const std::vector<std::string> sourceLabels {
+  "Word Clk", "AES 1", "AES 2", "AES 3", "AES 4",
+  "AES 5", "AES 6", "AES 7", "AES 8", "TCO", "Sync In"
+};
+
+HDSPeSimCard::HDSPeSimCard(const std::string& name, bool _tco, long serial)
+  : SndSimCard(name, "HDSPe", "RME AES (simulated) at " + name)
+  , tco(_tco)
+{
+  std::vector<std::string> refLabels = sourceLabels;
+  refLabels.push_back("Intern");
+  std::vector<std::string> syncFreqLabels = freqLabels;
+  syncFreqLabels.insert(syncFreqLabels.begin(), "-");
+
+  // Card info and common controls.
+  addInt  ("Status Polling", 1, 0, 1000);
+  addInt  ("Card Revision", 1, 0, 255, 0, READ);
+  addInt  ("Firmware Build", 1, 0, 65535, 0, READ);
+  addInt  ("Serial", 1, 0, 0x7fffffff, 0, READ);
+  addBool ("Running", 1, READ);
+  addInt  ("Buffer Size", 1, 0, 8192, 0, READ);
+  addBool ("TCO Present", 1, READ);
+  addEnum ("Clock Mode", 1, { "AutoSync", "Master" });
+  addEnum ("Internal Frequency", 1, freqLabels);
+  addEnum ("Preferred AutoSync Reference", 1, sourceLabels);
+  addEnum ("Current AutoSync Reference", 1, refLabels, READ);
+  addEnum ("AutoSync Status", nrSources,
+	   { "No Lock", "Lock", "Sync", "N/A" }, READ);
+  addEnum ("AutoSync Frequency", nrSources, syncFreqLabels, READ);
+  addInt64("Raw Sample Rate", 2, 0, ddsNumerator, 0, READ, 0,
+	   SND_CTL_ELEM_IFACE_HWDEP);
+  addInt  ("DDS", 1, ddsNumerator / 210000, ddsNumerator / 27000, 0,
+	   READWRITE, 0, SND_CTL_ELEM_IFACE_HWDEP);
+
+  // AES model controls.
+  addEnum ("Double Speed Mode", 1, { "Single Wire", "Double Wire" });
+  addEnum ("Quad Speed Mode", 1, { "Single Wire", "Double Wire", "Quad Wire" });
+  addBool ("Professional");
+  addBool ("Emphasis");
+  addBool ("Non Audio");
+  addBool ("Single Speed WordClk Out");
+  addBool ("Clear TMS");
+
+  if (tco) {
+    addInt  ("TCO Firmware", 1, 0, 255, 0, READ);
+    addInt64("LTC In", 2, 0, 0x7fffffffffffffffLL, 0, READ);
+    addBool ("LTC In Valid", 1, READ);
+    addEnum ("LTC In Frame Rate", 1, { "24", "25", "29.97", "30" }, READ);
+    addBool ("LTC In Drop Frame", 1, READ);
+    addInt  ("LTC In Pull Factor", 1, 0, 2000, 0, READ);
+    addInt64("LTC Out", 1, 0, 0x7fffffffffffffffLL);
+    addBool ("LTC Run");
+    addEnum ("LTC Sample Rate", 1, { "44.1 KHz", "48 KHz", "From App" });
+    addEnum ("LTC Frame Rate", 1,
+	     { "24 fps", "25 fps", "29.97 fps", "29.97 dfps", "30 fps", "30 dfps" });
+    addEnum ("TCO Video Format", 1, { "No video", "NTSC", "PAL" }, READ);
+    addEnum ("TCO Video Frame Rate", 1,
+	     { "23.98", "24", "25", "29.97", "30", "47.95", "48", "50",
+	       "59.94", "60" }, READ);
+    addBool ("TCO WordClk Valid", 1, READ);
+    addEnum ("TCO WordClk Speed", 1,
+	     { "Single Speed", "Double Speed", "Quad Speed" }, READ);
+    addEnum ("TCO WordClk Out Speed", 1,
+	     { "Single Speed", "Double Speed", "Quad Speed" });
+    addBool ("TCO Lock", 1, READ);
+    addEnum ("TCO Pull", 1, { "0", "+0.1 %", "-0.1 %", "+4 %", "-4 %" });
+    addEnum ("TCO WordClk Conversion", 1, { "1:1", "44.1 -> 48", "48 -> 44.1" });
+    addEnum ("TCO Sync Source", 1, { "WordClk", "Video", "LTC" });
+    addBool ("TCO WordClk Term");
+
+    set("TCO Firmware", {11});
+    set("LTC In Frame Rate", {1});
+    set("LTC In Pull Factor", {1000});
+  }
+
+  set("Card Revision", {0xd2});
+  set("Firmware Build", {18});
+  set("Serial", {serial});
+  set("Buffer Size", {256});
+  set("TCO Present", {tco});
+  set("Clock Mode", {1});
+  set("Preferred AutoSync Reference", {1});
+  set("Raw Sample Rate", {ddsNumerator, ddsNumerator / 48000});
+
+  std::vector<long long> status(nrSources, 0);
+  if (!tco)
+    status[9] = 3;  // TCO N/A
+  set("AutoSync Status", status);
+  set("Internal Frequency", {2});   // 48 KHz. Sets DDS.
+}
+
+void HDSPeSimCard::assign1(const std::string& name, unsigned i, long long value)
+{
+  size_t key = lookup(name, 0);
+  std::vector<long long> v = elems[key].values;
+  v[i] = value;
+  assign(key, v.data());
+}
+
+void HDSPeSimCard::updateClock(void)
+{
+  const std::vector<long long>& status = values("AutoSync Status");
+  const std::vector<long long>& freq = values("AutoSync Frequency");
+  bool master = values("Clock Mode")[0] != 0;
+  long long pref = values("Preferred AutoSync Reference")[0];
+
+  // In AutoSync mode, the card syncs to the preferred reference if it has
+  // lock, or to the first source that has lock otherwise.
+  auto locked = [&status](long long i) { return status[i]==1 || status[i]==2; };
+  long long ref = nrSources;   // Intern
+  if (!master) {
+    if (locked(pref))
+      ref = pref;
+    else
+      for (int i=0; i<nrSources && ref==nrSources; i++)
+	if (locked(i)) ref = i;
+  }
+  assign1("Current AutoSync Reference", 0, ref);
+
+  long long rate = ref < nrSources ? HDSPeCard::freqRate(freq[ref]) : 0;
+  assign1("Raw Sample Rate", 1,
+	  rate > 0 ? ddsNumerator / rate : values("DDS")[0]);
+}
+
+void HDSPeSimCard::onChange(size_t key)
+{
+  const std::string& name = elems[key].name;
+
+  if (name == "Internal Frequency") {
+    // The driver resets the internal pitch to the nominal rate.
+    int rate = HDSPeCard::freqRate(values(name)[0] + 1);
+    assign1("DDS", 0, ddsNumerator / rate);
+  }
+
+  else if (name == "AutoSync Status") {
+    // Inputs without lock have no frequency. Newly locked inputs run at
+    // the internal frequency.
+    const std::vector<long long> status = values(name);
+    long long internal = values("Internal Frequency")[0] + 1;
+    for (unsigned i=0; i<status.size(); i++) {
+      long long f = values("AutoSync Frequency")[i];
+      if (status[i] == 0 || status[i] == 3)
+	assign1("AutoSync Frequency", i, 0);
+      else if (f == 0)
+	assign1("AutoSync Frequency", i, internal);
+    }
+
+    // The driver disables status polling after each status change.
+    assign1("Status Polling", 0, 0);
+  }
+
+  updateClock();
+}
+
+void HDSPeSimCard::simulateSyncChanges(double rate)
+{
+  std::minstd_rand rng(1);
+  bool hasTco = tco;
+  simulate("AutoSync Status", rate,
+	   [rng, hasTco](std::vector<long long>& status) mutable {
+	     unsigned i = rng() % status.size();
+	     if (i == 9 && !hasTco)
+	       return;
+	     status[i] = rng() % 4;
+	   });
+}
+
+void HDSPeSimCard::simulateLtc(int fps)
+{
+  if (!tco)
+    return;
+
+  set("LTC In Frame Rate", {fps==24 ? 0 : fps==25 ? 1 : 3});
+  set("LTC In Valid", {1});
+  set("TCO Lock", {1});
+
+  // LTC In values: BCD encoded time code, frame count.
+  unsigned long long frame = 0;
+  simulate("LTC In", fps,
+	   [frame, fps](std::vector<long long>& ltc) mutable {
+	     frame++;
+	     unsigned long long f = frame % fps;
+	     unsigned long long s = (frame / fps) % 60;
+	     unsigned long long m = (frame / fps / 60) % 60;
+	     unsigned long long h = (frame / fps / 3600) % 24;
+	     ltc[0] = (f%10) | (f/10)<<8 | (s%10)<<16 | (s/10)<<24
+	       | (m%10)<<32 | (m/10)<<40 | (h%10)<<48 | (h/10)<<56;
+	     ltc[1] = frame;
+	   });
+}
@@ -0,0 +1,66 @@
+/*! \file HDSPeSimCard.h
+ *! \brief Simulated RME HDSPe AES card, for running hdspeconf without
+ *! hardware.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#ifndef _HDSPE_SIM_CARD_H_
+#define _HDSPE_SIM_CARD_H_
+
+#include <string>
+#include <vector>
+
+#include "SndSimCard.h"
+
+//! \brief Simulated RME HDSPe AES card, optionally with TCO module.
+//!
+//! Provides the control elements of the snd-hdspe driver for an AES card,
+//! with the same names, types and enumerated item labels, and emulates the
+//! driver behaviour hdspeconf depends on:
+//! - the current AutoSync reference and the system sample rate follow the
+//!   clock mode, preferred reference, input sync status and frequencies,
+//!   internal frequency and DDS;
+//! - "Status Polling" is reset to 0 on each AutoSync status change.
+//!
+//! The driver name is "HDSPe" and the long name starts with "RME AES", so
+//! HDSPeCardEnumerator recognizes it. See SndSimCard for the limitations
+//! of simulated cards.
+class HDSPeSimCard: public SndSimCard {
+ protected:
+  static const int nrSources { 11 };  //!< Word Clk, AES 1-8, TCO, Sync In.
+  static const long long ddsNumerator { 104857600000000LL };
+
+  bool tco;                           //!< Simulate a TCO module?
+
+  //! \brief Values of the named element. mtx must be held.
+  std::vector<long long>& values(const std::string& name)
+  {
+    return elems[lookup(name, 0)].values;
+  }
+
+  //! \brief Assign a single value to the named element, notifying a
+  //! change if any. mtx must be held.
+  void assign1(const std::string& name, unsigned i, long long value);
+
+  //! \brief Recompute current AutoSync reference and system sample rate.
+  //! mtx must be held.
+  void updateClock(void);
+
+  void onChange(size_t key) override;
+
+ public:
+  //! \brief Constructor: creates the AES card elements, with a TCO module if
+  //! tco is true. The card is in master mode at 48 KHz, with no sync
+  //! inputs connected.
+  HDSPeSimCard(const std::string& name ="sim:0", bool tco =false,
+	       long serial =0x5117);
+
+  //! \brief Connect and disconnect sync inputs at random, rate times per
+  //! second, with random single, double or quad speed frequencies.
+  void simulateSyncChanges(double rate);
+
+  //! \brief Feed LTC timecode at fps frames per second to the TCO module,
+  //! if present.
+  void simulateLtc(int fps =25);
+};
+
+#endif /* _HDSPE_SIM_CARD_H_ */
@@ -12,10 +12,12 @@
 #include "HDSPeConf.h"
 
 #define SET_CB(prop) card->prop.callOnValueChange(POSTCB(update_##prop,#prop))
+#define SET_MASK_CB(prop) card->prop.callOnChannelChange(POSTMASKCB(update_##prop,#prop))
 
 class MyMADIPanel: public MADIPanel {
  protected:
   class MADICard* card { nullptr };
+  RefreshBatcher refresh;   //!< Coalesces control value change updates.
 
   constexpr static const double UNSET_PITCH { -1.0 };
   double newPitch = UNSET_PITCH;
@@ -25,7 +27,7 @@ class MyMADIPanel: public MADIPanel {
     : MADIPanel(parent, wxID_ANY)
     , card(_card)
   {
-    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild));
+    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild.load(0)));
     
     SET_CB(running);
     SET_CB(bufferSize);
@@ -33,8 +35,8 @@ class MyMADIPanel: public MADIPanel {
     SET_CB(internalFreq);
     SET_CB(preferredRef);
     SET_CB(syncRef);
-    SET_CB(syncStatus);
-    SET_CB(syncFreq);
+    SET_MASK_CB(syncStatus);
+    SET_MASK_CB(syncFreq);
     SET_CB(sampleRate);
 
     SET_CB(externalFreq);
@@ -52,16 +54,16 @@ class MyMADIPanel: public MADIPanel {
 
   void update_running(void)
   {
-    internalFreqLabel->Show(card->running);
+    internalFreqLabel->Show(card->running.load(0));
     internalFreqLabel->SetLabelText(card->internalFreq.label());
     
-    internalFreqChoice->Show(!card->running);
-    internalFreqChoice->SetSelection(card->internalFreq.value());    
+    internalFreqChoice->Show(!card->running.load(0));
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));    
   }
 
   void update_bufferSize(void)
   {
-    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize));
+    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize.load(0)));
   }
 
   void update_clockMode(void)
@@ -83,26 +85,29 @@ class MyMADIPanel: public MADIPanel {
   void update_internalFreq(void)
   {
     internalFreqLabel->SetLabelText(card->internalFreq.label());
-    internalFreqChoice->SetSelection(card->internalFreq.value());
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));
     
     checkFreqs();
   }
   
-  void update_syncFreq(void)
+  // Only the sync inputs whose bit is set in mask are updated.
+  void update_syncFreq(uint64_t mask)
   {
-    wclkFreqLabel->SetLabelText(card->syncFreq.label(0));
-    madiFreqLabel->SetLabelText(card->syncFreq.label(1));
-    tcoFreqLabel->SetLabelText(card->syncFreq.label(2));
-    syncInFreqLabel->SetLabelText(card->syncFreq.label(3));
-    
-    checkFreqs();
+    wxStaticText* labels[] = {
+      wclkFreqLabel, madiFreqLabel, tcoFreqLabel, syncInFreqLabel
+    };
+    for (unsigned i=0; i<4; i++)
+      if (mask & SndControl::channelBit(i))
+	labels[i]->SetLabelText(card->syncFreq.label(i));
+
+    checkFreqs(mask);
   }
 
   void update_sampleRate(void)
   {
-    int rate = (int)round(card->getSystemSampleRate());
-    sampleRateLabel->SetLabelText(std::to_string(rate));
-    sampleRateLabel->SetBackgroundColour(card->isStandardSampleRate(rate)
+    SampleRate rate = card->getSystemRate();
+    sampleRateLabel->SetLabelText(std::to_string(rate.round()));
+    sampleRateLabel->SetBackgroundColour(rate.isStandard()
 					 ? wxNullColour : wxColour(0xff, 0xc6, 0x00));
 
     pitchSlider->Enable(card->isMaster());
@@ -127,7 +132,7 @@ class MyMADIPanel: public MADIPanel {
     masterButton->SetValue(card->isMaster());
     
     if (!card->isMaster()) {
-      switch (card->preferredRef) {
+      switch (card->preferredRef.load(0)) {
       case 0: wclkSyncButton->SetValue(true); break;
       case 1: madiSyncButton->SetValue(true); break;
       case 2: tcoSyncButton->SetValue(true); break;
@@ -136,34 +141,39 @@ class MyMADIPanel: public MADIPanel {
     }
   }
 
-  void checkFreqs(void)
+  void checkFreqs(uint64_t mask =~0ULL)
   {
     internalWarn->Show(card->internalRateDeviates());
 
-    unsigned* f = card->syncFreq.values();
-    wclkWarn->Show(!card->isClockCompatible(f[0]));
-    madiWarn->Show(!card->isClockCompatible(f[1]));
-    tcoWarn->Show(!card->isClockCompatible(f[2]));
-    syncInWarn->Show(!card->isClockCompatible(f[3]));
+    wxStaticBitmap* warns[] = { wclkWarn, madiWarn, tcoWarn, syncInWarn };
+    const std::vector<unsigned> f = card->syncFreq.load();
+    for (unsigned i=0; i<4; i++)
+      if (mask & SndControl::channelBit(i))
+	warns[i]->Show(!card->isClockCompatible(f[i]));
   }
 
-  void enableSyncButtons(void)
+  void enableSyncButtons(uint64_t mask =~0ULL)
   {
-    unsigned* s = card->syncStatus.values();
-    wclkSyncButton->Enable(s[0] != 3);
-    madiSyncButton->Enable(s[1] != 3);
-    tcoSyncButton->Enable(s[2] != 3);
-    syncInSyncButton->Enable(s[3] != 3);
+    wxRadioButton* buttons[] = {
+      wclkSyncButton, madiSyncButton, tcoSyncButton, syncInSyncButton
+    };
+    const std::vector<unsigned> s = card->syncStatus.load();
+    for (unsigned i=0; i<4; i++)
+      if (mask & SndControl::channelBit(i))
+	buttons[i]->Enable(s[i] != 3);
   }
 
-  void update_syncStatus(void)
+  // Only the sync inputs whose bit is set in mask are updated.
+  void update_syncStatus(uint64_t mask)
   {
-    wclkStatusLabel->SetLabelText(card->syncStatus.label(0));
-    madiStatusLabel->SetLabelText(card->syncStatus.label(1));
-    tcoStatusLabel->SetLabelText(card->syncStatus.label(2));
-    syncInStatusLabel->SetLabelText(card->syncStatus.label(3));
-    
-    enableSyncButtons();
+    wxStaticText* labels[] = {
+      wclkStatusLabel, madiStatusLabel, tcoStatusLabel, syncInStatusLabel
+    };
+    for (unsigned i=0; i<4; i++)
+      if (mask & SndControl::channelBit(i))
+	labels[i]->SetLabelText(card->syncStatus.label(i));
+
+    enableSyncButtons(mask);
   }
 
   void update_externalFreq(void)
@@ -173,32 +183,32 @@ class MyMADIPanel: public MADIPanel {
 
   void update_preferredInput(void)
   {
-    madiInputBox->SetSelection(card->preferredInput.value());
+    madiInputBox->SetSelection(card->preferredInput.load(0));
   }
 
   void update_currentInput(void)
   {
-    currentMadiInputBox->SetSelection(card->currentInput.value());
+    currentMadiInputBox->SetSelection(card->currentInput.load(0));
   }
 
   void update_autoselectInput(void)
   {
-    autoselectInputButton->SetValue(card->autoselectInput.value());
+    autoselectInputButton->SetValue(card->autoselectInput.load(0));
   }
 
   void update_rx64ch(void)
   {
-    rx64chButton->SetValue(card->rx64ch.value());
+    rx64chButton->SetValue(card->rx64ch.load(0));
   }
 
   void update_tx64ch(void)
   {
-    tx64chButton->SetValue(card->tx64ch.value());
+    tx64chButton->SetValue(card->tx64ch.load(0));
   }
 
   void update_doubleWire(void)
   {
-    doubleWireButton->SetValue(card->doubleWire.value());
+    doubleWireButton->SetValue(card->doubleWire.load(0));
   }
 
   void update_singleSpeedWclkOut(void)
@@ -208,13 +218,13 @@ class MyMADIPanel: public MADIPanel {
       singleSpeedWclkButton->SetValue(true);
     } else {
       singleSpeedWclkButton->Enable();
-      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut);
+      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut.load(0));
     }
   }
 
   void update_clrTms(void)
   {
-    tmsButton->SetValue(!card->clrTms);
+    tmsButton->SetValue(!card->clrTms.load(0));
   }
 
   void internalFreqCB(wxCommandEvent &event) override
@@ -312,8 +322,8 @@ class MyMADIPanel: public MADIPanel {
   }
 };
 
-MADICard::MADICard(int index)
-  : HDSPeCard(index)
+MADICard::MADICard(const std::string& cardName)
+  : HDSPeCard(cardName)
   , externalFreq(this, "External Frequency")
   , preferredInput(this, "Preferred Input")
   , currentInput(this, "Current Input")
@@ -328,6 +338,21 @@ MADICard::MADICard(int index)
   tcoSyncChoice = 2;
 }
 
+std::vector<std::pair<const char*, SndControl*>> MADICard::getModelControls(void)
+{
+  return {
+    { "externalFreq", &externalFreq },
+    { "preferredInput", &preferredInput },
+    { "currentInput", &currentInput },
+    { "autoselectInput", &autoselectInput },
+    { "rx64ch", &rx64ch },
+    { "tx64ch", &tx64ch },
+    { "doubleWire", &doubleWire },
+    { "singleSpeedWclkOut", &singleSpeedWclkOut },
+    { "clrTms", &clrTms }
+  };
+}
+
 MADICard::~MADICard()
 {
 }
@@ -21,9 +21,11 @@ class MADICard: public HDSPeCard {
   SndBoolControl doubleWire;
   SndBoolControl singleSpeedWclkOut;
   SndBoolControl clrTms;
+
+  std::vector<std::pair<const char*, SndControl*>> getModelControls(void) override;
   
  public:
-  MADICard(int index);
+  MADICard(const std::string& cardName);
   ~MADICard();
 
   class wxPanel* makePanel(class wxWindow* parent) override;
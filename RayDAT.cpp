@@ -16,6 +16,7 @@
 class MyRayDATPanel: public RayDATPanel {
  protected:
   class RayDATCard* card { nullptr };
+  RefreshBatcher refresh;   //!< Coalesces control value change updates.
 
   constexpr static const double UNSET_PITCH { -1.0 };
   double newPitch = UNSET_PITCH;
@@ -25,7 +26,7 @@ class MyRayDATPanel: public RayDATPanel {
     : RayDATPanel(parent, wxID_ANY)
     , card(_card)
   {
-    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild));
+    fwVersionLabel->SetLabelText(std::to_string(card->fwBuild.load(0)));
     
     SET_CB(running);
     SET_CB(bufferSize);
@@ -48,16 +49,16 @@ class MyRayDATPanel: public RayDATPanel {
 
   void update_running(void)
   {
-    internalFreqLabel->Show(card->running);
+    internalFreqLabel->Show(card->running.load(0));
     internalFreqLabel->SetLabelText(card->internalFreq.label());
     
-    internalFreqChoice->Show(!card->running);
-    internalFreqChoice->SetSelection(card->internalFreq.value());    
+    internalFreqChoice->Show(!card->running.load(0));
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));    
   }
 
   void update_bufferSize(void)
   {
-    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize));
+    bufferSizeLabel->SetLabelText(std::to_string(card->bufferSize.load(0)));
   }
 
   void update_clockMode(void)
@@ -79,7 +80,7 @@ class MyRayDATPanel: public RayDATPanel {
   void update_internalFreq(void)
   {
     internalFreqLabel->SetLabelText(card->internalFreq.label());
-    internalFreqChoice->SetSelection(card->internalFreq.value());
+    internalFreqChoice->SetSelection(card->internalFreq.load(0));
     
     checkFreqs();
   }
@@ -101,9 +102,9 @@ class MyRayDATPanel: public RayDATPanel {
 
   void update_sampleRate(void)
   {
-    int rate = (int)round(card->getSystemSampleRate());
-    sampleRateLabel->SetLabelText(std::to_string(rate));
-    sampleRateLabel->SetBackgroundColour(card->isStandardSampleRate(rate)
+    SampleRate rate = card->getSystemRate();
+    sampleRateLabel->SetLabelText(std::to_string(rate.round()));
+    sampleRateLabel->SetBackgroundColour(rate.isStandard()
 					 ? wxNullColour : wxColour(0xff, 0xc6, 0x00));
 
     pitchSlider->Enable(card->isMaster());
@@ -133,7 +134,7 @@ class MyRayDATPanel: public RayDATPanel {
     masterButton->SetValue(card->isMaster());
     
     if (!card->isMaster()) {
-      switch (card->preferredRef) {
+      switch (card->preferredRef.load(0)) {
       case 0: wclkSyncButton->SetValue(true); break;
       case 1: aesSyncButton->SetValue(true); break;
       case 2: spdifSyncButton->SetValue(true); break;
@@ -151,7 +152,7 @@ class MyRayDATPanel: public RayDATPanel {
   {
     internalWarn->Show(card->internalRateDeviates());
 
-    unsigned* f = card->syncFreq.values();
+    const std::vector<unsigned> f = card->syncFreq.load();
     wclkWarn->Show(!card->isClockCompatible(f[0]));
     aesWarn->Show(!card->isClockCompatible(f[1]));
     spdifWarn->Show(!card->isClockCompatible(f[2]));
@@ -165,7 +166,7 @@ class MyRayDATPanel: public RayDATPanel {
 
   void enableSyncButtons(void)
   {
-    unsigned* s = card->syncStatus.values();
+    const std::vector<unsigned> s = card->syncStatus.load();
     wclkSyncButton->Enable(s[0] != 3);
     aesSyncButton->Enable(s[1] != 3);
     spdifSyncButton->Enable(s[2] != 3);
@@ -194,27 +195,27 @@ class MyRayDATPanel: public RayDATPanel {
 
   void update_adat1Internal(void)
   {
-    adat1InternalButton->SetValue(card->adat1Internal);
+    adat1InternalButton->SetValue(card->adat1Internal.load(0));
   }
 
   void update_adat2Internal(void)
   {
-    adat2InternalButton->SetValue(card->adat2Internal);
+    adat2InternalButton->SetValue(card->adat2Internal.load(0));
   }
 
   void update_spdifIn(void)
   {
-    spdifInBox->SetSelection(card->spdifIn);
+    spdifInBox->SetSelection(card->spdifIn.load(0));
   }
 
   void update_spdifOpt(void)
   {
-    spdifOpticalButton->SetValue(card->spdifOpt);
+    spdifOpticalButton->SetValue(card->spdifOpt.load(0));
   }
 
   void update_spdifPro(void)
   {
-    spdifProButton->SetValue(card->spdifPro);
+    spdifProButton->SetValue(card->spdifPro.load(0));
   }
 
   void update_singleSpeedWclkOut(void)
@@ -224,13 +225,13 @@ class MyRayDATPanel: public RayDATPanel {
       singleSpeedWclkButton->SetValue(true);
     } else {
       singleSpeedWclkButton->Enable();
-      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut);
+      singleSpeedWclkButton->SetValue(card->singleSpeedWclkOut.load(0));
     }
   }
 
   void update_clrTms(void)
   {
-    tmsButton->SetValue(!card->clrTms);
+    tmsButton->SetValue(!card->clrTms.load(0));
   }
 
   void internalFreqCB(wxCommandEvent &event) override
@@ -363,8 +364,8 @@ class MyRayDATPanel: public RayDATPanel {
   }
 };
 
-RayDATCard::RayDATCard(int index)
-  : HDSPeCard(index)
+RayDATCard::RayDATCard(const std::string& cardName)
+  : HDSPeCard(cardName)
   , spdifIn(this, "S/PDIF In")
   , spdifOpt(this, "S/PDIF Out Optical")
   , spdifPro(this, "S/PDIF Out Professional")
@@ -377,6 +378,19 @@ RayDATCard::RayDATCard(int index)
   tcoSyncChoice = 7;
 }
 
+std::vector<std::pair<const char*, SndControl*>> RayDATCard::getModelControls(void)
+{
+  return {
+    { "spdifIn", &spdifIn },
+    { "spdifOpt", &spdifOpt },
+    { "spdifPro", &spdifPro },
+    { "singleSpeedWclkOut", &singleSpeedWclkOut },
+    { "clrTms", &clrTms },
+    { "adat1Internal", &adat1Internal },
+    { "adat2Internal", &adat2Internal }
+  };
+}
+
 RayDATCard::~RayDATCard()
 {
 }
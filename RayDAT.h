@@ -19,9 +19,11 @@ class RayDATCard: public HDSPeCard {
   SndBoolControl clrTms;
   SndBoolControl adat1Internal;
   SndBoolControl adat2Internal;  
+
+  std::vector<std::pair<const char*, SndControl*>> getModelControls(void) override;
   
  public:
-  RayDATCard(int index);
+  RayDATCard(const std::string& cardName);
   ~RayDATCard();
 
   class wxPanel* makePanel(class wxWindow* parent) override;
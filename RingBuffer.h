@@ -0,0 +1,80 @@
+/*! \file RingBuffer.h
+ *! \brief Lock-free single producer, single consumer ring buffer.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#ifndef _RING_BUFFER_H_
+#define _RING_BUFFER_H_
+
+#include <atomic>
+#include <stddef.h>
+
+//! \brief Fixed size, lock-free ring buffer for passing items from one
+//! producer thread to one consumer thread, e.g. from the control event
+//! handling thread to the GUI thread.
+//!
+//! Capacity N must be a power of two. push() shall only be called from
+//! the producer thread, pop() and clear() only from the consumer thread.
+//! Neither blocks. When the ring is full, push() drops the new item and
+//! counts it, so the consumer can detect the loss with getDropped().
+template<typename T, size_t N>
+class RingBuffer {
+  static_assert(N > 0 && (N & (N-1)) == 0, "RingBuffer capacity must be a power of two");
+
+ protected:
+  T items[N];
+  alignas(64) std::atomic<size_t> head { 0 };    //!< Next item to pop. Written by consumer.
+  alignas(64) std::atomic<size_t> tail { 0 };    //!< Next item to push. Written by producer.
+  alignas(64) std::atomic<size_t> dropped { 0 }; //!< Items dropped because the ring was full.
+
+ public:
+  //! \brief Ring capacity.
+  static constexpr size_t capacity(void) { return N; }
+
+  //! \brief Append item. Returns false, and drops the item, if the
+  //! ring is full. Producer thread only.
+  bool push(const T& item)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) >= N) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    items[t & (N-1)] = item;
+    tail.store(t+1, std::memory_order_release);
+    return true;
+  }
+
+  //! \brief Remove the oldest item into item. Returns false if the ring
+  //! is empty. Consumer thread only.
+  bool pop(T& item)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    item = items[h & (N-1)];
+    head.store(h+1, std::memory_order_release);
+    return true;
+  }
+
+  //! \brief Discard all queued items. Consumer thread only.
+  void clear(void)
+  {
+    head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  //! \brief Approximate number of queued items.
+  size_t size(void) const
+  {
+    size_t h = head.load(std::memory_order_acquire);
+    return tail.load(std::memory_order_acquire) - h;
+  }
+
+  //! \brief Returns whether the ring is (approximately) empty.
+  bool empty(void) const { return size() == 0; }
+
+  //! \brief Number of items dropped because the ring was full, since
+  //! construction.
+  size_t getDropped(void) const { return dropped.load(std::memory_order_relaxed); }
+};
+
+#endif /* _RING_BUFFER_H_ */
@@ -0,0 +1,118 @@
+/*! \file SampleRate.h
+ *! \brief Exact rational sample rate arithmetic.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#ifndef _SAMPLE_RATE_H_
+#define _SAMPLE_RATE_H_
+
+//! \brief Sample rate as the ratio of two 64-bit integers, e.g. the
+//! "Raw Sample Rate" numerator and denominator, or the same numerator
+//! and the "DDS" value.
+//!
+//! Comparisons and deviation tests are exact: they cross-multiply in
+//! 128-bit integers. pitch() does the same, and only converts to
+//! double at the final division, so it keeps full double precision,
+//! far below 1 PPM, also for nearly equal rates.
+class SampleRate {
+ protected:
+  using wide = __int128;
+
+  long long num { 0 };   //!< Numerator.
+  long long den { 1 };   //!< Denominator, always > 0.
+
+ public:
+  //! \brief Zero (invalid) sample rate.
+  SampleRate() {}
+
+  //! \brief Integer sample rate.
+  SampleRate(long long rate) : num(rate) {}
+
+  //! \brief Sample rate numerator / denominator. A zero denominator
+  //! yields an invalid (zero) rate.
+  SampleRate(long long numerator, long long denominator)
+    : num(denominator < 0 ? -numerator : numerator)
+    , den(denominator < 0 ? -denominator : denominator)
+  {
+    if (den == 0) { num = 0; den = 1; }
+  }
+
+  long long getNumerator(void) const { return num; }
+  long long getDenominator(void) const { return den; }
+
+  //! \brief Returns whether the rate is positive.
+  bool valid(void) const { return num > 0; }
+
+  //! \brief Rate in Hz, as a double.
+  double toDouble(void) const { return (double)num / (double)den; }
+
+  //! \brief Rate rounded to the nearest integer Hz.
+  long long round(void) const
+  {
+    return num >= 0 ? (num + den/2) / den : -((-num + den/2) / den);
+  }
+
+  //! \brief Returns <0, 0 or >0 if this rate is smaller than, equal to or
+  //! larger than other.
+  int compare(const SampleRate& other) const
+  {
+    wide l = (wide)num * other.den, r = (wide)other.num * den;
+    return l < r ? -1 : l > r ? 1 : 0;
+  }
+
+  bool operator==(const SampleRate& o) const { return compare(o) == 0; }
+  bool operator!=(const SampleRate& o) const { return compare(o) != 0; }
+  bool operator< (const SampleRate& o) const { return compare(o) <  0; }
+  bool operator<=(const SampleRate& o) const { return compare(o) <= 0; }
+  bool operator> (const SampleRate& o) const { return compare(o) >  0; }
+  bool operator>=(const SampleRate& o) const { return compare(o) >= 0; }
+
+  //! \brief Double or quad speed rate converted to single speed rate.
+  SampleRate singleSpeed(void) const
+  {
+    if (*this >= SampleRate(112000))
+      return SampleRate(num, den * 4);
+    if (*this >= SampleRate(56000))
+      return SampleRate(num, den * 2);
+    return *this;
+  }
+
+  //! \brief (this - ref) / ref: 0 if both rates are equal, <0 if this is
+  //! smaller, >0 if larger, -1 if this rate is 0. 0 if ref is invalid.
+  double pitch(const SampleRate& ref) const
+  {
+    if (!ref.valid())
+      return 0.;
+    wide d = (wide)num * ref.den - (wide)ref.num * den;
+    wide r = (wide)ref.num * den;
+    return (double)d / (double)r;
+  }
+
+  //! \brief Returns true if both rates are valid and this rate deviates
+  //! from ref by limitPpm PPM or more. Exact.
+  bool deviates(const SampleRate& ref, long long limitPpm =100) const
+  {
+    if (!valid() || !ref.valid())
+      return false;
+    wide d = (wide)num * ref.den - (wide)ref.num * den;
+    if (d < 0) d = -d;
+    return d * 1000000 >= (wide)limitPpm * ref.num * den;
+  }
+
+  //! \brief Nearest standard sample rate: 32000, 44100 or 48000 Hz, times
+  //! 1, 2 or 4 depending on speed mode.
+  SampleRate nearestStandard(void) const
+  {
+    long long factor = *this >= SampleRate(112000) ? 4
+      : *this >= SampleRate(56000) ? 2 : 1;
+    SampleRate single(num, den * factor);
+    long long rate = single < SampleRate(38050) ? 32000
+      : single < SampleRate(46050) ? 44100 : 48000;
+    return SampleRate(rate * factor);
+  }
+
+  //! \brief Returns true if the rate deviates less than 100 PPM from the
+  //! nearest standard sample rate.
+  bool isStandard(void) const { return !deviates(nearestStandard()); }
+};
+
+#endif /* _SAMPLE_RATE_H_ */
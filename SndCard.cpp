@@ -7,54 +7,396 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <map>
+
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include <alsa/asoundlib.h>
 
 #include "SndCard.h"
 #include "SndControl.h"
 
-//! \brief SndCard control event handling thread.
+//! \brief Control event handling thread, shared by all SndCard objects
+//! in the process.
+//!
+//! The poll descriptors of each attached card are registered with a
+//! single epoll instance. snd_hctl_handle_events() is dispatched as soon
+//! as a card descriptor becomes readable. An eventfd wakes up the thread
+//! for shutdown, and for delivering the element events posted by
+//! SndCard::postEvent(). The thread is started when the first card is attached
+//! and stopped when the last card is detached.
+//!
+//! A card may be closed from within one of its own control callbacks.
+//! Its hctl handle is then closed once snd_hctl_handle_events() returned.
+//! If it was the last card, the thread deletes its own instance when it
+//! returns.
 class SndCardEventThread {
 public:
-  SndCardEventThread(SndCard* _card)
-    : card(_card)
-    , t([this](){main();})
+  //! \brief Register the card's hctl poll descriptors, starting the
+  //! shared event thread if needed.
+  static void attach(SndCard* card);
+
+  //! \brief Queue an element event for control of card, and wake up the
+  //! thread to deliver it.
+  void post(SndCard* card, SndControl* control, unsigned mask);
+
+  //! \brief Drop the queued events for control.
+  void cancel(SndControl* control);
+
+  //! \brief Unregister the card and close its hctl handle. Returns only
+  //! after any event dispatch for the card in progress on another thread
+  //! has finished. Stops the event thread if this was the last card.
+  static void detach(SndCard* card, snd_hctl_t* hctl);
+
+private:
+  static std::mutex instanceMutex;            //!< Protects instance.
+  static SndCardEventThread* instance;        //!< The shared event thread.
+
+  int epfd { -1 };                 //!< epoll instance.
+  int evfd { -1 };                 //!< eventfd, signaled for shutdown and posted events.
+  std::atomic<bool> shutdown_requested {false};
+  bool orphaned { false };         //!< Last card detached by a callback: main() deletes us.
+
+  //! \brief Attached card and a copy of its poll descriptors.
+  struct Registration {
+    SndCard* card { nullptr };
+    std::vector<struct pollfd> pfds;
+  };
+  std::recursive_mutex mtx;                   //!< Protects cards, serialises dispatch.
+  std::map<uint32_t, Registration> cards;     //!< Attached cards, by registration id.
+  uint32_t nextId { 1 };                      //!< Id 0 identifies the eventfd.
+  SndCard* dispatching { nullptr };           //!< Card whose events are being handled.
+  snd_hctl_t* closing { nullptr };            //!< Its hctl, if closed by a callback.
+
+  //! \brief Element event posted by SndCard::postEvent().
+  struct Posted {
+    SndCard* card;
+    SndControl* control;
+    unsigned mask;
+  };
+  std::mutex postMtx;                         //!< Protects posted. Never wait for mtx holding it.
+  std::vector<Posted> posted;                 //!< Posted events not delivered yet.
+
+  std::thread t;
+
+  SndCardEventThread();
+  ~SndCardEventThread();
+
+  void add(SndCard* card);
+  bool remove(SndCard* card, snd_hctl_t* hctl =nullptr);
+  bool empty(void);
+  void dispatch(uint32_t id, int fd, uint32_t events);
+  void deliverPosted(void);
+  void main(void);
+};
+
+std::mutex SndCardEventThread::instanceMutex;
+SndCardEventThread* SndCardEventThread::instance { nullptr };
+
+void SndCardEventThread::attach(SndCard* card)
+{
+  std::lock_guard<std::mutex> lock(instanceMutex);
+  if (!instance)
+    instance = new SndCardEventThread;
+  instance->add(card);
+  card->events = instance;
+}
+
+void SndCardEventThread::detach(SndCard* card, snd_hctl_t* hctl)
+{
+  SndCardEventThread* done { nullptr };
+  bool deferred { false };
   {
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    card->events = nullptr;
+    if (instance) {
+      deferred = instance->remove(card, hctl);
+      if (instance->empty()) {
+	done = instance;
+	instance = nullptr;
+      }
+    }
   }
+  if (!deferred)
+    snd_hctl_close(hctl);
 
-  ~SndCardEventThread()
-  {
-    shutdown_requested = true;
+  if (!done)
+    return;
+  if (done->t.get_id() == std::this_thread::get_id()) {
+    // Last card closed from within a callback: dispatch() and main()
+    // are still running on this thread. main() deletes the instance.
+    done->orphaned = true;
+    done->shutdown_requested = true;
+  } else
+    delete done;   // joins the thread, outside instanceMutex.
+}
+
+SndCardEventThread::SndCardEventThread()
+{
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (epfd < 0)
+    throw std::runtime_error("SndCardEventThread: epoll_create1 failed: "
+			     + std::string(strerror(errno)) + "\n");
+  evfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (evfd < 0) {
+    ::close(epfd);
+    throw std::runtime_error("SndCardEventThread: eventfd failed: "
+			     + std::string(strerror(errno)) + "\n");
+  }
+
+  struct epoll_event ev {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = 0;              // registration id 0: the eventfd.
+  epoll_ctl(epfd, EPOLL_CTL_ADD, evfd, &ev);
+
+  t = std::thread([this](){main();});
+}
+
+SndCardEventThread::~SndCardEventThread()
+{
+  shutdown_requested = true;
+  uint64_t one = 1;
+  if (::write(evfd, &one, sizeof(one)) < 0)
+    std::cerr << "SndCardEventThread: eventfd write failed.\n";
+  if (t.get_id() == std::this_thread::get_id())
+    t.detach();   // deleted by main() itself, see detach().
+  else
     t.join();
+  ::close(evfd);
+  ::close(epfd);
+}
+
+void SndCardEventThread::add(SndCard* card)
+{
+  Registration reg;
+  reg.card = card;
+  int n = SndCheckErr(snd_hctl_poll_descriptors_count(*card),
+		      "hctl_poll_descriptors_count");
+  reg.pfds.resize(n);
+  SndCheckErr(snd_hctl_poll_descriptors(*card, reg.pfds.data(), n),
+	      "hctl_poll_descriptors");
+
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  uint32_t id = nextId++;
+  cards[id] = reg;
+
+  // epoll only hands back our cookie: encode registration id and fd in it.
+  for (auto& pfd: reg.pfds) {
+    struct epoll_event ev {};
+    // POLLxxx and EPOLLxxx bits coincide. Error conditions are always
+    // reported by epoll, and POLLNVAL has no epoll equivalent.
+    ev.events = pfd.events & (POLLIN | POLLPRI | POLLOUT);
+    ev.data.u64 = ((uint64_t)id << 32) | (uint32_t)pfd.fd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, pfd.fd, &ev) < 0)
+      std::cerr << "SndCardEventThread: epoll_ctl failed for card "
+		<< card->getName() << ": " << strerror(errno) << "\n";
   }
+}
 
-private:
-  SndCard* card { nullptr };
-  std::thread t;
-  std::atomic<bool> shutdown_requested {false};
-  
-  void main(void)
+bool SndCardEventThread::remove(SndCard* card, snd_hctl_t* hctl)
+{
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  for (auto it = cards.begin(); it != cards.end(); it++) {
+    if (it->second.card != card)
+      continue;
+    for (auto& pfd: it->second.pfds)
+      epoll_ctl(epfd, EPOLL_CTL_DEL, pfd.fd, nullptr);
+    cards.erase(it);
+    break;
+  }
   {
-    try {
-      while (!shutdown_requested) {
-	if (snd_hctl_wait(*card, 1000)) {
-	  //	  std::cerr << "SndCardEventThread: got events ...\n";
-	  SndCheckErr(snd_hctl_handle_events(*card), "hctl_handle_events");
-	}
+    std::lock_guard<std::mutex> plock(postMtx);
+    for (auto p = posted.begin(); p != posted.end(); )
+      p = p->card == card ? posted.erase(p) : p+1;
+  }
+
+  // dispatching is only set while this thread holds mtx: if it is the
+  // card, we are in one of its callbacks, on the event thread.
+  if (hctl && dispatching == card) {
+    closing = hctl;
+    return true;
+  }
+  return false;
+}
+
+void SndCardEventThread::post(SndCard* card, SndControl* control, unsigned mask)
+{
+  {
+    std::lock_guard<std::mutex> lock(postMtx);
+    bool merged = false;
+    for (auto& p: posted)
+      if (p.control == control) {
+	p.mask |= mask;
+	merged = true;
+      }
+    if (!merged)
+      posted.push_back(Posted { card, control, mask });
+  }
+  uint64_t one = 1;
+  if (::write(evfd, &one, sizeof(one)) < 0)
+    std::cerr << "SndCardEventThread: eventfd write failed.\n";
+}
+
+void SndCardEventThread::cancel(SndControl* control)
+{
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  std::lock_guard<std::mutex> plock(postMtx);
+  for (auto p = posted.begin(); p != posted.end(); )
+    p = p->control == control ? posted.erase(p) : p+1;
+}
+
+bool SndCardEventThread::empty(void)
+{
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  return cards.empty();
+}
+
+void SndCardEventThread::dispatch(uint32_t id, int fd, uint32_t events)
+{
+  std::lock_guard<std::recursive_mutex> lock(mtx);
+  auto it = cards.find(id);
+  if (it == cards.end())
+    return;     // detached in the mean time.
+  SndCard* card = it->second.card;
+
+  std::vector<struct pollfd>& pfds = it->second.pfds;
+  for (auto& pfd: pfds)
+    pfd.revents = (pfd.fd == fd) ? events : 0;
+  unsigned short revents {0};
+  SndCheckErr(snd_hctl_poll_descriptors_revents(*card, pfds.data(), pfds.size(), &revents),
+	      "hctl_poll_descriptors_revents");
+
+  if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+    std::cerr << "SndCardEventThread: card " << card->getName()
+	      << " went away.\n";
+    remove(card);
+    return;
+  }
+  if (revents & POLLIN) {
+    dispatching = card;
+    int err = snd_hctl_handle_events(*card);
+    dispatching = nullptr;
+    if (closing) {
+      // card was closed by one of its callbacks: only its handle is left.
+      snd_hctl_close(closing);
+      closing = nullptr;
+      return;
+    }
+    SndCheckErr(err, "hctl_handle_events");
+  }
+}
+
+void SndCardEventThread::deliverPosted(void)
+{
+  for (;;) {
+    // Like dispatch(): cancel() waits for a delivery in progress.
+    std::lock_guard<std::recursive_mutex> lock(mtx);
+    Posted p;
+    {
+      std::lock_guard<std::mutex> plock(postMtx);
+      if (posted.empty())
+	return;
+      p = posted.front();
+      posted.erase(posted.begin());
     }
-    } catch (std::runtime_error& e) {
-      std::cerr << "SndCardEventThread: " << e.what() << "on card " << card->getName() << "\n";
-    } catch (...) {
-      std::cerr << "SndCardEventThread: unknown error.\n";
+
+    dispatching = p.card;
+    SndControl::_elem_cb(p.control->getHandle(), p.mask);
+    dispatching = nullptr;
+    if (closing) {
+      snd_hctl_close(closing);   // see dispatch().
+      closing = nullptr;
     }
   }
-};
+}
+
+void SndCardEventThread::main(void)
+{
+  static const int maxevents = 16;
+  struct epoll_event events[maxevents];
+
+  while (!shutdown_requested) {
+    int n = epoll_wait(epfd, events, maxevents, -1);
+    if (n < 0) {
+      if (errno == EINTR)
+	continue;
+      std::cerr << "SndCardEventThread: epoll_wait failed: "
+		<< strerror(errno) << "\n";
+      break;
+    }
+
+    for (int i=0; i<n && !shutdown_requested; i++) {
+      uint32_t id = events[i].data.u64 >> 32;
+      int fd = (int)(events[i].data.u64 & 0xffffffff);
+      if (id == 0) {
+	// Shutdown or posted events. Reset the eventfd before delivering,
+	// so events posted meanwhile wake us up again.
+	uint64_t count;
+	if (::read(evfd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+	  std::cerr << "SndCardEventThread: eventfd read failed.\n";
+	if (!shutdown_requested)
+	  deliverPosted();
+	continue;
+      }
+
+      try {
+	dispatch(id, fd, events[i].events);
+      } catch (std::runtime_error& e) {
+	std::cerr << "SndCardEventThread: " << e.what() << "\n";
+      } catch (...) {
+	std::cerr << "SndCardEventThread: unknown error.\n";
+      }
+    }
+  }
+
+  if (orphaned)
+    delete this;
+}
+
+static std::mutex backendMutex;
+static std::vector<SndBackend*> backends;
+
+void SndCard::addBackend(SndBackend* backend)
+{
+  std::lock_guard<std::mutex> lock(backendMutex);
+  backends.push_back(backend);
+}
+
+void SndCard::removeBackend(SndBackend* backend)
+{
+  std::lock_guard<std::mutex> lock(backendMutex);
+  for (auto it = backends.begin(); it != backends.end(); it++)
+    if (*it == backend) { backends.erase(it); break; }
+}
 
 void SndCard::open(const std::string& name)
 {
-  // open the card.
-  SndCheckErr(snd_hctl_open(&hctl, name.c_str(), SND_CTL_NONBLOCK), "hctl_open_ctl");
-  ctl = snd_hctl_ctl(hctl);
+  // open the card, through a registered backend if one recognizes the name.
+  {
+    std::lock_guard<std::mutex> lock(backendMutex);
+    for (auto b: backends) {
+      if ((ctl = b->openCtl(name, SND_CTL_NONBLOCK))) {
+	backend = b;
+	break;
+      }
+    }
+  }
+  if (ctl) {
+    int err = snd_hctl_open_ctl(&hctl, ctl);
+    if (err < 0) {
+      snd_ctl_close(ctl);
+      SndCheckErr(err, "hctl_open_ctl");
+    }
+  } else {
+    SndCheckErr(snd_hctl_open(&hctl, name.c_str(), SND_CTL_NONBLOCK), "hctl_open_ctl");
+    ctl = snd_hctl_ctl(hctl);
+  }
 
   // load card info.
   snd_ctl_card_info_malloc(&card_info);
@@ -63,23 +405,57 @@ void SndCard::open(const std::string& name)
   // pre-load control elements.
   SndCheckErr(snd_hctl_load(hctl), "hctl_load");
 
-  evThread = new SndCardEventThread(this);
+  SndCardEventThread::attach(this);
 }
 
 void SndCard::close(void)
 {
-  delete evThread;
+  SndCardEventThread::detach(this, hctl);
+
+  {
+    std::lock_guard<std::mutex> lock(hwdepMutex);
+    for (auto& h: hwdep)
+      snd_hwdep_close(h.second);
+    hwdep.clear();
+  }
   
   snd_ctl_card_info_free(card_info);
-  snd_hctl_close(hctl);
 }
 
-void SndCard::ioctl(uint32_t request, int mode, void* pdata) const
+void SndCard::postEvent(SndControl* control, unsigned mask) const
+{
+  if (events)
+    events->post(const_cast<SndCard*>(this), control, mask);
+}
+
+void SndCard::cancelEvents(SndControl* control) const
+{
+  if (events)
+    events->cancel(control);
+}
+
+snd_hwdep_t* SndCard::getHwdep(int mode) const
 {
+  std::lock_guard<std::mutex> lock(hwdepMutex);
+  auto it = hwdep.find(mode);
+  if (it != hwdep.end())
+    return it->second;
+
   snd_hwdep_t *hw {nullptr};
   SndCheckErr(snd_hwdep_open(&hw, name.c_str(), mode), "hwdep_open");
-  SndCheckErr(snd_hwdep_ioctl(hw, request, pdata), "hwdep_ioctl");
-  snd_hwdep_close(hw);
+  hwdep[mode] = hw;
+  return hw;
+}
+
+void SndCard::ioctl(uint32_t request, int mode, void* pdata) const
+{
+  if (backend)
+    return backend->ioctl(name, request, mode, pdata);
+
+  // The kernel serialises what needs to be on a shared hwdep handle:
+  // no need to hold hwdepMutex during the ioctl.
+  // Handles are only closed in close().
+  SndCheckErr(snd_hwdep_ioctl(getHwdep(mode), request, pdata), "hwdep_ioctl");
 }
 
 const std::vector<class SndControl*> SndCard::getControls(void) const
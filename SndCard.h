@@ -15,8 +15,14 @@
  *
  * Construct SndCard object from an ALSA sound card index or name.
  *
- * Control elements are pre-loaded and a asynchronous callback function
- * installed in order to catch element events.
+ * Control elements are pre-loaded and the card is attached to the
+ * process-wide control event handling thread in order to catch element
+ * events. That thread waits for events on all open cards at once, using
+ * epoll, and dispatches them as soon as they arrive. Closing a card
+ * detaches it immediately. The thread exits when the last card is closed.
+ * A card may also be closed, or deleted, from within one of its own
+ * control callbacks: its control handle is then closed as soon as the
+ * event dispatch in progress returns.
  *
  * Getting information
  * -------------------
@@ -46,36 +52,89 @@
  * ----------------
  * 
  * - SndCard::ioctl() performs a hwdep ioctl read or write on the sound card.
+ *   The hwdep device is opened on first use, and kept open until the card
+ *   is closed, so frequent ioctls do not cost a device open and close each.
+ *
+ * Backends
+ * --------
+ *
+ * By default, cards are opened through ALSA's snd_hctl_open(). A SndBackend
+ * registered with SndCard::addBackend() can provide the control handle
+ * for card names it recognizes instead, e.g. an in-process simulated card
+ * (see SndSimCard). All SndControl functionality then works unchanged on
+ * top of that handle.
  */
 
 #pragma once
 
+#include <map>
+#include <mutex>
 #include <string>
 #include <vector>
+#include <stdint.h>
 
 #include "Snd.h"
 
+//! \brief Pluggable provider of control handles and hwdep access for
+//! SndCard.
+//!
+//! See \ref cardplusplus page.
+class SndBackend {
+public:
+  virtual ~SndBackend() {}
+
+  //! \brief Open a control handle for the named card, with given
+  //! snd_ctl_open() mode. Returns nullptr if the card name is not handled
+  //! by this backend.
+  virtual snd_ctl_t* openCtl(const std::string& cardName, int mode) =0;
+
+  //! \brief Perform a hwdep ioctl on the named card.
+  virtual void ioctl(const std::string& cardName,
+		     uint32_t request, int mode, void* pdata) =0;
+};
+
 //! \brief ALSA sound card control handle C++ wrapper.
 //!
 //! See \ref cardplusplus page.
 class SndCard {
 protected:
   friend class SndControl;
+  friend class SndCardEventThread;
 
   std::string name;                   //!< ALSA card name.
   
   snd_ctl_t *ctl { nullptr };         //!< ALSA sound card control handle.
   snd_hctl_t *hctl { nullptr };       //!< ALSA sound card hcontrol handle.
   snd_ctl_card_info_t *card_info { nullptr };   //!< ALSA sound card info.
+  SndBackend *backend { nullptr };    //!< Backend providing the handle, or nullptr for ALSA.
+  class SndCardEventThread *events { nullptr }; //!< Event handling thread, while attached.
+
+  mutable std::mutex hwdepMutex;      //!< Protects hwdep.
+  mutable std::map<int, snd_hwdep_t*> hwdep;  //!< hwdep handles, per open mode, opened on first use.
 
   //! \brief Open the sound card control handle, preload control elements
-  //! and install an asynchronous callback handler to catch element
-  //! change notification events.
+  //! and attach the card to the shared control event handling thread
+  //! to catch element change notification events.
   void open(const std::string& cardName);
 
-  //! \brief Close the sound card control handle.
+  //! \brief Detach from the event handling thread and close the sound
+  //! card control handle and hwdep handles.
   void close(void);
 
+  //! \brief Get the hwdep handle for the given open mode, opening the
+  //! hwdep device if not done before.
+  snd_hwdep_t* getHwdep(int mode) const;
+
+  //! \brief Have the event handling thread deliver an element event with
+  //! given mask to control, as if it came from the driver. Events posted
+  //! for the same control before delivery are combined.
+  void postEvent(class SndControl* control, unsigned mask) const;
+
+  //! \brief Drop the events posted for control and not delivered yet.
+  //! Returns only after a delivery to control in progress on another
+  //! thread has finished.
+  void cancelEvents(class SndControl* control) const;
+
 public:
   //! \brief Constructor: open sound card by index.
   SndCard(int index)
@@ -162,9 +221,16 @@ public:
   //! \note Elements eventually must be deleted by the caller.
   const std::vector<class SndControl*> getControls(void) const;
 
-  //! \brief Perform a hwdep ioctl on the sound card.
+  //! \brief Perform a hwdep ioctl on the sound card. The hwdep device
+  //! is opened once for each mode and kept open until the card is closed.
+  //! Concurrent calls from different threads are allowed.
   void ioctl(uint32_t request, int mode, void* pdata) const;
 
-protected:
-  class SndCardEventThread* evThread { nullptr }; //!< Event handling thread.
+  //! \brief Register a backend. Backends are consulted in order of
+  //! registration when a card is opened. The backend must remain
+  //! valid as long as cards opened through it exist.
+  static void addBackend(SndBackend* backend);
+
+  //! \brief Unregister a backend.
+  static void removeBackend(SndBackend* backend);
 };
@@ -0,0 +1,146 @@
+/*! \file SndCoalescingWriter.h
+ *! \brief Rate limited, last value wins, writes to an ALSA control element.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#ifndef _SND_COALESCING_WRITER_H_
+#define _SND_COALESCING_WRITER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "SndControl.h"
+
+//! \brief Writes values to a SndAnyControl at most maxRate times per second,
+//! from a thread of its own.
+//!
+//! set() does not block: it replaces the pending value of the channel, if
+//! any, and returns. The writer thread writes the pending values as soon
+//! as the previous write is at least 1/maxRate seconds ago. Intermediate
+//! values set in between are never written, but the last value set is
+//! always written, also when the writer is destroyed.
+//!
+//! Meant for controls driven by continuous user input, such as a pitch
+//! slider, which would otherwise cause a driver write and a change event
+//! for each input event. Write errors are reported on std::cerr.
+template<typename T>
+class SndCoalescingWriter {
+ protected:
+  using Clock = std::chrono::steady_clock;
+
+  SndAnyControl<T>& ctl;           //!< Control to write.
+  Clock::duration period;          //!< Minimum time between writes.
+
+  mutable std::mutex mtx;          //!< Protects the members below.
+  std::condition_variable cond;    //!< Signals new values and termination.
+  std::thread thread;              //!< Writer thread, started by the first set().
+  std::vector<T> values;           //!< Pending values.
+  std::vector<bool> dirty;         //!< Which channels have a pending value.
+  std::vector<T> writing;          //!< Values being written.
+  std::vector<bool> inFlight;      //!< Which channels are being written.
+  bool pending { false };          //!< Any channel dirty?
+  bool stop { false };             //!< Writer thread termination request.
+  Clock::time_point lastWrite;     //!< Time of the last write.
+
+  //! \brief Writer thread main loop.
+  void main(void)
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    for (;;) {
+      cond.wait(lock, [this](){ return pending || stop; });
+      if (!pending)
+	return;
+      if (!stop)
+	cond.wait_until(lock, lastWrite + period, [this](){ return stop; });
+
+      std::vector<T> newval;
+      {
+	SndControl::CacheLocker g(ctl);
+	newval = ctl;
+      }
+      for (size_t i=0; i<newval.size() && i<dirty.size(); i++)
+	if (dirty[i]) newval[i] = values[i];
+      writing = newval;
+      inFlight = dirty;
+      dirty.assign(dirty.size(), false);
+      pending = false;
+
+      lock.unlock();
+      try {
+	ctl.set(newval);
+      } catch (std::runtime_error& e) {
+	std::cerr << e.what();
+      }
+      lock.lock();
+      inFlight.assign(inFlight.size(), false);
+      lastWrite = Clock::now();
+    }
+  }
+
+ public:
+  //! \brief Constructor: writes to ctl at most maxRate times per second.
+  SndCoalescingWriter(SndAnyControl<T>& _ctl, double maxRate =50.)
+    : ctl(_ctl)
+    , period(std::chrono::duration_cast<Clock::duration>
+	     (std::chrono::duration<double>(1. / maxRate)))
+    , values(_ctl.getCount())
+    , dirty(_ctl.getCount(), false)
+    , inFlight(_ctl.getCount(), false)
+  {
+  }
+
+  //! \brief Destructor: writes the pending values, if any, and stops the
+  //! writer thread.
+  ~SndCoalescingWriter()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+    }
+    cond.notify_all();
+    if (thread.joinable())
+      thread.join();
+  }
+
+  //! \brief Set the value of the channel, to be written at the next
+  //! write.
+  void set(const T& value, unsigned channel =0)
+  {
+    if (channel >= values.size())
+      throw std::runtime_error("SndCoalescingWriter: SndControl '"
+			       + ctl.getName() + "' channel index "
+			       + std::to_string(channel) + " out of range.\n");
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      values[channel] = value;
+      dirty[channel] = true;
+      pending = true;
+      if (!thread.joinable())
+	thread = std::thread([this](){ main(); });
+    }
+    cond.notify_all();
+  }
+
+  //! \brief Get the value set for the channel that is not yet written,
+  //! or is being written. Returns false, leaving value untouched, if
+  //! there is none: the control then has the last value set.
+  bool getPending(T& value, unsigned channel =0) const
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (channel < dirty.size() && dirty[channel]) {
+      value = values[channel];
+      return true;
+    }
+    if (channel < inFlight.size() && inFlight[channel]) {
+      value = writing[channel];
+      return true;
+    }
+    return false;
+  }
+};
+
+#endif /* _SND_COALESCING_WRITER_H_ */
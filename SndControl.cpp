@@ -2,8 +2,12 @@
  *! \brief ALSA sound card control element C++ wrappers.
  * 20210810,12,0902,03,04,06,12 - Philippe.Bekaert@uhasselt.be */
 
+#include <algorithm>
 #include <iostream>
 
+#include <errno.h>
+#include <stdlib.h>
+
 #include "SndControl.h"
 #include "SndCard.h"
 
@@ -89,6 +93,14 @@ SndControl* SndControl::Create(const class SndCard* card,
 int SndControl::_elem_cb(snd_hctl_elem_t *elem, unsigned int mask)
 {
   SndControl* c = (SndControl*) snd_hctl_elem_get_callback_private(elem);
+  c->elemLockEvent();
+  if (mask != SND_CTL_EVENT_MASK_REMOVE) {
+    std::lock_guard<std::mutex> lock(c->muteMtx);
+    if (c->eventsMuted > 0) {
+      c->mutedEvents |= mask;
+      return 0;
+    }
+  }
   try {
     c->onElemEvent(mask);
   } catch (const std::runtime_error& e) {
@@ -108,11 +120,23 @@ SndControl::SndControl(const class SndCard* _card,
   SndCheckErr(snd_hctl_elem_info(elem, info), "hctl_elem_info");
   type = snd_ctl_elem_info_get_type(info);
   count = snd_ctl_elem_info_get_count(info);
+
+  // Element id and ASCII id don't change: capture them once, rather than
+  // on every lock, dB conversion or id query.
+  SndCheckErr(snd_ctl_elem_id_malloc(&id), "ctl_elem_id_malloc");
+  snd_hctl_elem_get_id(elem, id);
+  char* ascii = snd_ctl_ascii_elem_id_get(id);
+  if (ascii) {
+    asciiId = ascii;
+    free(ascii);
+  }
 }
 
 SndControl::~SndControl()
 {
   snd_hctl_elem_set_callback(elem, nullptr);
+  card->cancelEvents(this);
+  snd_ctl_elem_id_free(id);
   snd_ctl_elem_info_free(info);
 }
 
@@ -131,57 +155,308 @@ const std::string SndControl::getCardName(void) const
   return card->getName();
 }
 
-const std::string SndControl::getAsciiId(void) const
-{
-  snd_ctl_elem_id_t* id;
-  snd_ctl_elem_id_alloca(&id);  
-  getId(id);
-  return std::string(snd_ctl_ascii_elem_id_get(id));
-}
-
 int SndControl::getdBRange(long* min, long* max) const
 {
-  snd_ctl_elem_id_t* id;
-  snd_ctl_elem_id_alloca(&id);  
-  getId(id);
   return snd_ctl_get_dB_range(*card, id, min, max);
 }
 
 int SndControl::convertTodB(long volume, long* db_gain) const 
 {
-  snd_ctl_elem_id_t* id;
-  snd_ctl_elem_id_alloca(&id);  
-  getId(id);
   return snd_ctl_convert_to_dB(*card, id, volume, db_gain);
 }
 
 int SndControl::convertFromdB(long db_gain, long* volume, int xdir) const
 {
-  snd_ctl_elem_id_t* id;
-  snd_ctl_elem_id_alloca(&id);  
-  getId(id);
   return snd_ctl_convert_from_dB(*card, id, db_gain, volume, xdir);
 }
 
 bool SndControl::try_lock(void)
 {
-  snd_ctl_elem_id_t* id;
-  snd_ctl_elem_id_alloca(&id);  
-  getId(id);
   int rc = snd_ctl_elem_lock(*card, id);
-  if (rc != 0 && rc != EBUSY)
+  if (rc != 0 && rc != -EBUSY)
     SndCheckErr(rc, "ctl_elem_lock");
   return rc == 0;
 }
 
 void SndControl::unlock(void)
 {
-  snd_ctl_elem_id_t* id;
-  snd_ctl_elem_id_alloca(&id);  
-  getId(id);
   SndCheckErr(snd_ctl_elem_unlock(*card, id), "ctl_elem_unlock");
 }
 
+int SndControl::lockElem(const std::chrono::steady_clock::time_point* deadline)
+{
+  using namespace std::chrono;
+  std::unique_lock<std::mutex> lock(elemLockMtx);
+  const std::thread::id self = std::this_thread::get_id();
+  if (elemLockDepth > 0 && elemLockOwner == self) {
+    elemLockDepth++;
+    return 0;
+  }
+
+  elemLockWaiters++;
+  milliseconds backoff(1);
+  int rc = 0;
+  for (;;) {
+    // Another thread of this process holds the lock: wait for its release.
+    if (elemLockDepth > 0) {
+      if (!deadline)
+	elemLockCond.wait(lock, [this](){ return elemLockDepth == 0; });
+      else if (!elemLockCond.wait_until(lock, *deadline,
+					[this](){ return elemLockDepth == 0; })) {
+	rc = -ETIMEDOUT;
+	break;
+      }
+    }
+
+    unsigned events = elemLockEvents;
+    rc = snd_ctl_elem_lock(*card, id);
+    if (rc != -EBUSY)
+      break;
+
+    // Another process holds the lock.
+    steady_clock::time_point wake = steady_clock::now() + backoff;
+    if (deadline) {
+      if (steady_clock::now() >= *deadline) {
+	rc = -ETIMEDOUT;
+	break;
+      }
+      wake = std::min(wake, *deadline);
+    }
+    elemLockCond.wait_until(lock, wake, [this, events](){
+	return elemLockEvents != events || elemLockDepth > 0;
+      });
+    backoff = std::min(backoff * 2, milliseconds(64));
+  }
+  elemLockWaiters--;
+
+  if (rc == 0) {
+    elemLockOwner = self;
+    elemLockDepth = 1;
+  }
+  return rc;
+}
+
+void SndControl::unlockElem(void)
+{
+  std::unique_lock<std::mutex> lock(elemLockMtx);
+  if (elemLockDepth == 0 || elemLockOwner != std::this_thread::get_id())
+    throw std::runtime_error("SndControl '" + name + "' on card '"
+			     + getCardName() + "' element lock not held by this thread.\n");
+  if (--elemLockDepth > 0)
+    return;
+  int rc = snd_ctl_elem_unlock(*card, id);
+  elemLockOwner = std::thread::id();
+  lock.unlock();
+  elemLockCond.notify_all();
+  SndCheckErr(rc, "ctl_elem_unlock");
+}
+
+void SndControl::elemLockEvent(void)
+{
+  if (elemLockWaiters == 0)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(elemLockMtx);
+    elemLockEvents++;
+  }
+  elemLockCond.notify_all();
+}
+
+void SndControl::muteEvents(void)
+{
+  std::lock_guard<std::mutex> lock(muteMtx);
+  eventsMuted++;
+}
+
+void SndControl::unmuteEvents(void)
+{
+  unsigned mask = 0;
+  {
+    std::lock_guard<std::mutex> lock(muteMtx);
+    if (eventsMuted > 0 && --eventsMuted == 0) {
+      mask = mutedEvents;
+      mutedEvents = 0;
+    }
+  }
+  if (mask)
+    card->postEvent(this, mask);
+}
+
+void SndEnumControl::loadLabels(void) const
+{
+  // Take the generation before reading: an INFO event from here on
+  // makes the table stale again.
+  unsigned gen = labelGen;
+  if (labelsLoaded == gen)
+    return;
+
+  // Own info: the shared one may be in use by other threads.
+  snd_ctl_elem_info_t* inf;
+  snd_ctl_elem_info_alloca(&inf);
+  SndCheckErr(snd_hctl_elem_info(elem, inf), "hctl_elem_info");
+  unsigned items = snd_ctl_elem_info_get_items(inf);
+  labelTable.clear();
+  labelOffset.resize(items);
+  for (unsigned i=0; i<items; i++) {
+    snd_ctl_elem_info_set_item(inf, i);
+    SndCheckErr(snd_hctl_elem_info(elem, inf), "hctl_elem_info");
+    labelOffset[i] = labelTable.size();
+    labelTable.append(snd_ctl_elem_info_get_item_name(inf));
+    labelTable.push_back('\0');
+  }
+  labelsLoaded = gen;
+}
+
+const std::string SndEnumControl::getEnumLabel(unsigned value) const
+{
+  std::lock_guard<std::mutex> lock(labelMtx);
+  loadLabels();
+  if (labelOffset.empty())
+    return std::string();
+  // Like the driver does when asked for an item out of range: the last.
+  if (value >= labelOffset.size())
+    value = labelOffset.size() - 1;
+  return std::string(labelTable.data() + labelOffset[value]);
+}
+
+void SndIntControl::loaddB(void) const
+{
+  CacheLocker g(const_cast<SndIntControl*>(this));
+  if (dbValid)
+    return;
+
+  dbTlv = nullptr;
+  dbTable.clear();
+  dbError = -EINVAL;
+  dbValid = true;
+  if (!isTlvReadable())
+    return;
+
+  // The driver refuses a buffer that is too small: grow it.
+  int rc;
+  dbTlvData.resize(1024);
+  while ((rc = snd_hctl_elem_tlv_read(elem, dbTlvData.data(),
+				      dbTlvData.size() * sizeof(unsigned int))) == -ENOMEM
+	 && dbTlvData.size() < maxTlvWords)
+    dbTlvData.resize(dbTlvData.size() * 2);
+  if (rc < 0) {
+    std::cerr << "SndControl '" << name << "' on card '" << getCardName()
+	      << "': reading dB TLV data failed: " << snd_strerror(rc) << "\n";
+    dbError = rc;
+    return;
+  }
+  rc = snd_tlv_parse_dB_info(dbTlvData.data(),
+			     dbTlvData.size() * sizeof(unsigned int), &dbTlv);
+  if (rc <= 0) {
+    dbTlv = nullptr;
+    dbError = rc < 0 ? rc : -EINVAL;
+    return;
+  }
+  dbError = 0;
+
+  long min, max, step;
+  getRange(&min, &max, &step);
+  if (max >= min && max - min < maxdBTableSize) {
+    dbTable.resize(max - min + 1);
+    for (long v=min; v<=max; v++) {
+      if (snd_tlv_convert_to_dB(dbTlv, min, max, v, &dbTable[v-min]) < 0) {
+	dbTable.clear();
+	break;
+      }
+    }
+  }
+}
+
+int SndIntControl::valuesTodB(std::vector<long>& db) const
+{
+  if (!dbValid)
+    loaddB();
+
+  CacheLocker g(const_cast<SndIntControl*>(this));
+  if (!dbTlv)
+    return dbError;
+
+  long min, max, step;
+  getRange(&min, &max, &step);
+  db.resize(count);
+  for (unsigned i=0; i<count; i++) {
+    long v = val[i];
+    if (!dbTable.empty() && v >= min && v <= max)
+      db[i] = dbTable[v-min];
+    else {
+      int rc = snd_tlv_convert_to_dB(dbTlv, min, max, v, &db[i]);
+      if (rc < 0)
+	return rc;
+    }
+  }
+  return 0;
+}
+
+int SndIntControl::getdBRange(long* min, long* max) const
+{
+  if (!dbValid)
+    loaddB();
+
+  CacheLocker g(const_cast<SndIntControl*>(this));
+  if (!dbTlv)
+    return dbError;
+  long rmin, rmax, step;
+  getRange(&rmin, &rmax, &step);
+  return snd_tlv_get_dB_range(dbTlv, rmin, rmax, min, max);
+}
+
+int SndIntControl::convertTodB(long volume, long* db_gain) const
+{
+  if (!dbValid)
+    loaddB();
+
+  CacheLocker g(const_cast<SndIntControl*>(this));
+  if (!dbTlv)
+    return dbError;
+  long min, max, step;
+  getRange(&min, &max, &step);
+  if (!dbTable.empty() && volume >= min && volume <= max) {
+    *db_gain = dbTable[volume-min];
+    return 0;
+  }
+  return snd_tlv_convert_to_dB(dbTlv, min, max, volume, db_gain);
+}
+
+int SndIntControl::convertFromdB(long db_gain, long* volume, int xdir) const
+{
+  if (!dbValid)
+    loaddB();
+
+  CacheLocker g(const_cast<SndIntControl*>(this));
+  if (!dbTlv)
+    return dbError;
+  long min, max, step;
+  getRange(&min, &max, &step);
+  return snd_tlv_convert_from_dB(dbTlv, min, max, db_gain, volume, xdir);
+}
+
+int SndIntControl::setdB(const std::vector<long>& db, int xdir)
+{
+  if (!dbValid)
+    loaddB();
+
+  {CacheLocker g(this);
+    if (!dbTlv)
+      return dbError;
+
+    long min, max, step;
+    getRange(&min, &max, &step);
+    std::vector<long> newval(std::min((size_t)count, db.size()));
+    for (unsigned i=0; i<newval.size(); i++) {
+      int rc = snd_tlv_convert_from_dB(dbTlv, min, max, db[i], &newval[i], xdir);
+      if (rc < 0)
+	return rc;
+    }
+    SndAnyControl::operator=(newval);}
+  write();
+  return 0;
+}
+
 #ifdef NEVER
 //#include <stdio.h>
 //#include <sys/types.h>
@@ -78,6 +78,8 @@
  * - SndControl::getCard() returns a pointer to the SndCard to which the control belongs.
  * - SndControl::getInfo() returns the snd_ctl_elem_info_t info for the control.
  * - SndControl::getId() fills in a copy of the snd_ctl_elem_id_t ID of the element.
+ * SndControl::getIdRef() returns the ID itself. The ID and ASCII identifier are
+ * captured once, at construction.
  * - SndControl::getAsciiId() returns the ASCII control element identifier name.
  * - SndControl::getName(), SndControl::getInterface(), SndControl::getIndex(), SndControl::getDevice(), SndControl::getSubDevice(),
  * SndControl::getType() and SndControl::getCount() are shortcuts returning name, interface, index,
@@ -110,6 +112,11 @@
  * notification. Note that not all ALSA control elements send such
  * notifications, in particular volatile control elements may not.
  * Their values still need to be read on demand.
+ *
+ * The value change callback is called only if the values read upon a
+ * change notification differ from the cached values, or values were
+ * written since the previous callback. Enable SndControl::setAlwaysNotify()
+ * to have it called on every notification.
  * 
  * Writing control values
  * ----------------------
@@ -162,6 +169,48 @@
  *       volume.write();
  *     }
  * 
+ * Lock-free value access
+ * ----------------------
+ *
+ * Controls with at most SndAnyControl<T>::maxLockFreeBytes bytes of
+ * values (e.g. up to 64 integer64 channels) maintain a seqlock protected
+ * copy of their values, next to the value cache. The copy is published
+ * each time values are read() from the driver, including on change
+ * notification, and after each successful write(). Writers publish while
+ * holding the CacheLocker, so they stay serialised.
+ *
+ * - SndAnyControl::load() returns a consistent copy of all published
+ * values, or of a single channel value, without taking any lock. Readers
+ * such as the GUI or a monitoring thread thus never wait for the event
+ * handling thread, nor it for them.
+ * - SndAnyControl::isLockFree() tells whether load() is lock-free for a
+ * control. For larger controls, load() takes a CacheLocker instead.
+ *
+ * load() does not see cached values that were modified but not yet
+ * written. Use a CacheLocker for read-modify-write sequences, as before.
+ *
+ * Write-through mode
+ * ------------------
+ *
+ * By default, each value change event, including the one caused by our
+ * own write(), reads the values back from the driver. In write-through
+ * mode, write() records a sequence number when it changes values. The
+ * value change event that echoes the write is then served from the cache,
+ * saving a read ioctl. Value change callbacks still run.
+ *
+ * Write-through mode is off by default, and only enabled by
+ * SndControl::setWriteThrough(). It does not apply to volatile elements,
+ * nor to elements with more than SndAnyControl<T>::maxLockFreeBytes bytes
+ * of values. It trades correctness for a read:
+ * - snd_hctl_elem_write() does not return the values the driver actually
+ * stored. If the driver clamps or otherwise adjusts a written value, the
+ * cache keeps the value as written.
+ * - The kernel merges pending events for the same element. A value change
+ * by another process that is merged with our echo is missed.
+ *
+ * Enable it only on elements which no other process writes, and whose
+ * driver stores any valid value unmodified and never changes it on its own.
+ *
  * Value range checking
  * --------------------
  * 
@@ -183,6 +232,11 @@
  * data.
  * . SndControl::convertTodB() and SndControl::convertFromdB() convert raw volume values to/from
  * gain in 0.01 dB units.
+ * . SndIntControl::valuesTodB() and SndIntControl::setdB() convert all channels at once, from
+ * the value cache resp. into the value cache before writing. The TLV data is read once and
+ * re-read only after a TLV change, so these are cheap for controls with many channels.
+ * SndIntControl overrides getdBRange(), convertTodB() and convertFromdB() to use the same
+ * cached TLV data.
  * 
  * Value/info/TLV change callback
  * ------------------------------
@@ -222,10 +276,24 @@
  *     };
  * 
  *
- * Each SndCard object has a event handling thread. The callbacks are invoked
- * from the SndCards event handling thread. Callbacks from the same SndCard
- * are thus automatically serialized and will never cause synchronisation
- * issues among each other.
+ * All SndCard objects share a single event handling thread. The callbacks
+ * are invoked from that thread. Callbacks are thus automatically serialized,
+ * also across cards, and will never cause synchronisation issues among each
+ * other.
+ *
+ * The callOnXXXChange() callbacks are single: setting one replaces the
+ * previous one. Several independent parties, e.g. a GUI panel, a logger and
+ * a daemon client, can watch the same control with
+ * SndControl::subscribeValueChange(), subscribeChannelChange(),
+ * subscribeInfoChange() resp. subscribeTlvChange(). These return a
+ * Subscription token, which removes the callback when destroyed:
+ *
+ *     Subscription sub = syncSource.subscribeValueChange([this] () {onSyncSourceChange();});
+ *
+ * Subscribed callbacks are called after the callOnXXXChange() callback,
+ * in subscription order, under the same conditions. Subscribing and
+ * unsubscribing may happen from any thread. Once a Subscription is
+ * destroyed, its callback is guaranteed not to run anymore.
  *
  * Locking
  * -------
@@ -242,8 +310,11 @@
  * by the ALSA core in the linux kernel through the snd_ctl_elem_lock() and 
  * snd_ctl_elem_unlock() calls. The lock is taken by the ElemLocker constructor
  * and released by the destructor. The constructor waits until the lock is
- * acquired, retrying snd_ctl_elem_lock() every milisecond as long as
- * another process holds the lock. ElemLocker does not prevent other threads 
+ * acquired, retrying snd_ctl_elem_lock() when an event arrives for the
+ * element and otherwise after a backoff delay growing from 1 to 64
+ * milliseconds, as long as another process holds the lock. With a timeout
+ * argument, the constructor gives up after the timeout, and
+ * ElemLocker::status() tells whether the lock was obtained. ElemLocker does not prevent other threads 
  * in the process holding the lock to access the control element. And neither 
  * does it protect the SndControl value cache.
  *
@@ -262,6 +333,14 @@
  * Both lockers allow recursive locking. The lock is released by the destructor
  * of the outer-most locker.
  *
+ * Value change callbacks run with the CacheLocker of their control held.
+ * A thread holding several CacheLockers, e.g. SndTransaction::commit(), may
+ * thus block the event handling thread, but never the other way around,
+ * provided callbacks follow this rule: a callback does not take the
+ * CacheLocker of any other control. It reads other controls with
+ * SndAnyControl::load() (lock-free for small controls), and leaves writes
+ * to other controls to another thread.
+ *
  * As always, improper use of the locking mechanisms can lead to deadlock
  * and starvation.
  *
@@ -281,8 +360,16 @@
 #include <mutex>
 #include <stdexcept>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+
+#include <stdint.h>
+#include <string.h>
 
 #include "Snd.h"
+#include "SubscriberList.h"
 
 //! \brief ALSA control element wrapper base class.
 //!
@@ -301,8 +388,10 @@ protected:
 
   snd_hctl_elem_t* elem { nullptr }; //!< ALSA hcontrol handle.
   snd_ctl_elem_info_t* info { nullptr };  //!< ALSA control element info.
+  snd_ctl_elem_id_t* id { nullptr }; //!< ALSA control element id, captured at construction.
 
   std::string name;                  //!< Control name.
+  std::string asciiId;               //!< ASCII control element identifier.
   snd_ctl_elem_type_t type { SND_CTL_ELEM_TYPE_NONE };  //!< ALSA value type.
   unsigned count { 0 };              //!< Number of channels in control.
 
@@ -400,13 +489,17 @@ public:
   //! \brief Get a copy of the snd_ctl_elem_id_t of the control element.
   //! \note You need to allocate storage for a snd_ctl_elem_id_t with
   //! snd_ctl_elem_id_alloca() or consorts before calling this function.
-  void getId(snd_ctl_elem_id_t* id) const
+  void getId(snd_ctl_elem_id_t* _id) const
   {
-    snd_hctl_elem_get_id(elem, id);
+    snd_ctl_elem_id_copy(_id, id);
   }
 
+  //! \brief Get the snd_ctl_elem_id_t of the control element, without
+  //! copying. Valid as long as this SndControl exists.
+  const snd_ctl_elem_id_t* getIdRef(void) const { return id; }
+
   //! \brief Get ASCII control element identifier name.
-  const std::string getAsciiId(void) const;
+  const std::string& getAsciiId(void) const     { return asciiId; }
   
   //! \brief Get the ALSA interface to which this control is connected.
   snd_ctl_elem_iface_t getInterface(void) const
@@ -542,16 +635,16 @@ public:
   
   //! \brief Get the dB range in 0.01 dB units of the control element. Returns 0
   //! if succesful, and a negative error code otherwise.
-  int getdBRange(long* min, long* max) const;
+  virtual int getdBRange(long* min, long* max) const;
 
   //! \brief Convert raw volume value to dB gain, in 0.01 dB units. Returns
   //! 0 if succesful, and a negative error code otherwise.
-  int convertTodB(long volume, long* db_gain) const;
+  virtual int convertTodB(long volume, long* db_gain) const;
 
   //! \brief Convert dB gain in 0.01dB units, to raw volume value.Returns
   //! 0 if succesful, and a negative error code otherwise. xdir determines
   //! the direction of rounding: up if positive, down if negative.
-  int convertFromdB(long db_gain, long* volume, int xdir) const;
+  virtual int convertFromdB(long db_gain, long* volume, int xdir) const;
 
   //! \brief Read control element values from the driver, into the value cache.
   virtual void read(void) =0;
@@ -565,6 +658,22 @@ public:
   //! \brief Info/Value/TLV change callback function.
   using Callback = std::function<void(void)>;
 
+  //! \brief Channel value change callback function. Bit i of the argument
+  //! is set if the value of channel i changed. See channelBit().
+  using ChannelCallback = std::function<void(uint64_t mask)>;
+
+  //! \brief Change mask bit for channel i. Channels 63 and up share bit 63.
+  static uint64_t channelBit(unsigned i)
+  {
+    return i < 63 ? (uint64_t)1 << i : (uint64_t)1 << 63;
+  }
+
+  //! \brief Change mask with the bits of all channels of this control set.
+  uint64_t allChannels(void) const
+  {
+    return count >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+  }
+
   //! \brief Set callback to be called upon change of control element
   //! info. Setting nullptr disables.
   //! \param cb : callback function to be invoked upon change of info.
@@ -600,6 +709,24 @@ public:
     return old;
   }
 
+  //! \brief Set callback to be called upon change of control element
+  //! value, with the mask of channels that changed. Setting nullptr
+  //! disables. Works like callOnValueChange(), and is called right after
+  //! the value change callback. The immediate invocation has all
+  //! channels set.
+  //!
+  //! The mask is computed on the SndCard's event handling thread, by
+  //! comparing the values read with the cached values. Values written
+  //! by write() count as changed, if they differ from the values
+  //! read or written before.
+  ChannelCallback callOnChannelChange(ChannelCallback cb)
+  {
+    ChannelCallback old = onChannelChange;
+    onChannelChange = cb;
+    if (cb) cb(allChannels());
+    return old;
+  }
+
   //! \brief Set callback to be called upon change of control element
   //! TLV. Setting nullptr disables.
   //! \param cb : callback function to be invoked upon change of TLV.
@@ -616,6 +743,70 @@ public:
     return old;
   }
 
+  //! \brief Add a value change callback, in addition to the one set by
+  //! callOnValueChange() and other subscriptions. cb is removed when the
+  //! returned Subscription is destroyed.
+  //!
+  //! Immediately invokes cb, from the current thread. Later invocations
+  //! are from the SndCard's event handling thread.
+  Subscription subscribeValueChange(Callback cb)
+  {
+    Subscription sub = valueSubscribers.add(cb);
+    if (cb) cb();
+    return sub;
+  }
+
+  //! \brief Like subscribeValueChange(), for channel value change
+  //! callbacks (see callOnChannelChange()).
+  Subscription subscribeChannelChange(ChannelCallback cb)
+  {
+    Subscription sub = channelSubscribers.add(cb);
+    if (cb) cb(allChannels());
+    return sub;
+  }
+
+  //! \brief Like subscribeValueChange(), for info change callbacks.
+  Subscription subscribeInfoChange(Callback cb)
+  {
+    Subscription sub = infoSubscribers.add(cb);
+    if (cb) cb();
+    return sub;
+  }
+
+  //! \brief Like subscribeValueChange(), for TLV change callbacks.
+  Subscription subscribeTlvChange(Callback cb)
+  {
+    Subscription sub = tlvSubscribers.add(cb);
+    if (cb) cb();
+    return sub;
+  }
+
+  //! \brief Enable or disable write-through mode. See \ref controlplusplus
+  //! page. Has no effect on volatile control elements.
+  void setWriteThrough(bool enable)
+  {
+    CacheLocker g(this);
+    writeThrough = enable;
+    echoSeq = writeSeq;
+  }
+
+  //! \brief Check whether write-through mode is enabled.
+  bool isWriteThrough(void) const { return writeThrough; }
+
+  //! \brief If enabled, the value change callback is called on every value
+  //! change event. By default, it is called only if the values read
+  //! differ from the cached values, or were written since the previous
+  //! call. Enable for volatile elements, whose events are used as a
+  //! trigger to read.
+  void setAlwaysNotify(bool enable)
+  {
+    CacheLocker g(this);
+    alwaysNotify = enable;
+  }
+
+  //! \brief Check whether always notify mode is enabled.
+  bool isAlwaysNotify(void) const { return alwaysNotify; }
+
   //! \brief Print control element c value to the stream s.
   friend std::ostream& operator<<(std::ostream& s, const SndControl& c)
   {
@@ -677,40 +868,56 @@ public:
   //! objects.
   class ElemLocker {
   private:
-    std::atomic_uint refCnt {0};
     SndControl* ctl { nullptr };  //!< Refers to the control element object being locked.
+    int rc { 0 };                 //!< Lock acquisition status.
 
-    void lock(void)
-    {
-      while (!ctl->try_lock()) { usleep(1000); }
-      refCnt++;
-    }
-
-    void unlock(void)
-    {
-      if (--refCnt == 0)
-	ctl->unlock();
-    }
-    
   public:
     //! \brief Constructor: waits until the inter-process lock on the control
-    //! element is obtained.
+    //! element is obtained. Throws if it cannot be obtained for another
+    //! reason than another process holding it.
     //! \param ctl : reference to the SndControl object to be protected.
-    ElemLocker(SndControl& _ctl) : ctl(&_ctl) { lock(); }
+    ElemLocker(SndControl& _ctl) : ctl(&_ctl)
+    {
+      SndCheckErr(rc = ctl->lockElem(nullptr), "ctl_elem_lock");
+    }
 
     //! \brief Same, with SndControl pointer argument rather then reference.
     //! \param ctl : pointer to the SndControl object to be protected.    
-    ElemLocker(SndControl* _ctl) : ctl(_ctl) { lock(); }
+    ElemLocker(SndControl* _ctl) : ElemLocker(*_ctl) {}
 
-    //! \brief Destructor: releases the inter-process control element lock.
-    ~ElemLocker() { unlock(); }
+    //! \brief Constructor: waits at most timeout for the inter-process lock
+    //! on the control element. Does not throw: check status() or
+    //! ownsLock() to see whether the lock was obtained.
+    ElemLocker(SndControl& _ctl, std::chrono::milliseconds timeout) : ctl(&_ctl)
+    {
+      std::chrono::steady_clock::time_point deadline =
+	std::chrono::steady_clock::now() + timeout;
+      rc = ctl->lockElem(&deadline);
+    }
+
+    //! \brief Returns 0 if the lock was obtained, -ETIMEDOUT if the timeout
+    //! expired, or another negative error code.
+    int status(void) const { return rc; }
+
+    //! \brief Returns whether the lock was obtained.
+    bool ownsLock(void) const { return rc == 0; }
+
+    //! \brief Destructor: releases the inter-process control element lock,
+    //! if obtained.
+    ~ElemLocker() { if (rc == 0) ctl->unlockElem(); }
   };
   
 protected:
   Callback onValueChange { nullptr };   //!< Valued change user callback. Set to nullptr to disable.
+  ChannelCallback onChannelChange { nullptr }; //!< Channel value change user callback. Set to nullptr to disable.
   Callback onInfoChange { nullptr };    //!< Info change user callback. Set to nullptr to disable.
   Callback onTlvChange { nullptr };     //!< TLV change user callback. Set to nullptr to disable.
 
+  SubscriberList<Callback> valueSubscribers;          //!< Subscribed value change callbacks.
+  SubscriberList<ChannelCallback> channelSubscribers; //!< Subscribed channel value change callbacks.
+  SubscriberList<Callback> infoSubscribers;           //!< Subscribed info change callbacks.
+  SubscriberList<Callback> tlvSubscribers;            //!< Subscribed TLV change callbacks.
+
   //! \brief Tries to acquire the ALSA core provided system-wide inter-process
   //! lock on this control element. Other processes
   //! trying to write the control elements values will fail with a
@@ -727,6 +934,73 @@ protected:
   //! \brief System-wide unlock the control element.
   void unlock(void);
 
+  //! \brief Acquire the system-wide inter-process lock on the control
+  //! element, recursively for the thread already holding it. Other threads
+  //! of this process wait until the holding thread releases it.
+  //!
+  //! While another process holds the lock, waits until an event arrives
+  //! for the element, e.g. because the holder wrote new values, or until a
+  //! backoff delay expires, doubling from 1 ms up to 64 ms, and retries.
+  //! ALSA does not notify lock releases, hence the backoff.
+  //!
+  //! \return Returns 0 if the lock was obtained, -ETIMEDOUT if deadline
+  //! (unless nullptr) passed first, and another negative error code if
+  //! snd_ctl_elem_lock() fails otherwise.
+  int lockElem(const std::chrono::steady_clock::time_point* deadline);
+
+  //! \brief Release one level of the lock taken with lockElem(), unlocking
+  //! the control element when the outer-most level is released.
+  void unlockElem(void);
+
+  //! \brief Wakes threads waiting in lockElem(). Called on each event for
+  //! the element.
+  void elemLockEvent(void);
+
+  std::mutex elemLockMtx;              //!< Protects the element lock state below.
+  std::condition_variable elemLockCond; //!< Signals element events and lock releases.
+  std::thread::id elemLockOwner;       //!< Thread holding the element lock.
+  unsigned elemLockDepth { 0 };        //!< Recursion depth of the element lock.
+  unsigned elemLockEvents { 0 };       //!< Count of element events, for waiters.
+  std::atomic<unsigned> elemLockWaiters { 0 }; //!< Number of threads waiting in lockElem().
+
+  //! \brief Hold back element events until unmuteEvents(). Nests.
+  void muteEvents(void);
+
+  //! \brief Undo one muteEvents(). When the outer-most level is undone,
+  //! posts the events held back, if any, as a single event with the
+  //! combined mask, to the control event handling thread. Callbacks thus
+  //! always run on that thread.
+  void unmuteEvents(void);
+
+  std::mutex muteMtx;                  //!< Protects eventsMuted and mutedEvents.
+  unsigned eventsMuted { 0 };          //!< Events are held back while > 0.
+  unsigned mutedEvents { 0 };          //!< SND_CTL_EVENT_MASK_XXX bits of held back events.
+
+  friend class SndTransaction;
+  friend class SndCardEventThread;     //!< Delivers the events posted by unmuteEvents().
+
+  // Write-through mode: each write() whose value change event is expected
+  // to echo back values already in the cache increments writeSeq. The
+  // value change event handler then skips read() as long as echoSeq lags
+  // behind, and catches up. Protected by rmtx.
+  bool writeThrough { false };     //!< Write-through mode enabled?
+  uint64_t writeSeq { 0 };         //!< Sequence number of the last own write expecting an echo.
+  uint64_t echoSeq { 0 };          //!< Sequence number of the last echo consumed.
+
+  bool alwaysNotify { false };     //!< Call onValueChange on every value change event?
+  uint64_t changedMask { 0 };      //!< Channels changed since the value change callbacks were last called. Protected by rmtx.
+
+  //! \brief Called upon a value change event: returns true, and consumes
+  //! the echo, if the event is the echo of own writes.
+  bool consumeEcho(void)
+  {
+    CacheLocker g(this);
+    if (echoSeq == writeSeq)
+      return false;
+    echoSeq = writeSeq;
+    return true;
+  }
+
   std::recursive_mutex rmtx;   //!< Synchronises access to the cached values.
 };
 
@@ -742,9 +1016,54 @@ protected:
 //! See \ref controlplusplus page for more details.
 template<typename T>
 class SndAnyControl: public SndControl {
+ public:
+  //! \brief Max. size of the values for lock-free load().
+  static const size_t maxLockFreeBytes { 512 };
+
  protected:
   std::vector<T> val;    //!< Control element value cache.
 
+  //! \brief Seqlock protected copy of the published values, as 64-bit
+  //! words, or nullptr if the values are too large. The sequence number is
+  //! odd while publishing.
+  std::unique_ptr<std::atomic<uint64_t>[]> mirror;
+  size_t mirrorWords { 0 };                //!< Size of mirror.
+  std::atomic<unsigned> mirrorSeq { 0 };   //!< Sequence number.
+
+  //! \brief Copy the cached values to the mirror. The CacheLocker must be
+  //! held: it serialises writers.
+  void publish(void)
+  {
+    if (!mirror)
+      return;
+
+    uint64_t buf[maxLockFreeBytes / sizeof(uint64_t)] {};
+    memcpy(buf, val.data(), val.size() * sizeof(T));
+
+    unsigned seq = mirrorSeq.load(std::memory_order_relaxed);
+    mirrorSeq.store(seq+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i=0; i<mirrorWords; i++)
+      mirror[i].store(buf[i], std::memory_order_relaxed);
+    mirrorSeq.store(seq+2, std::memory_order_release);
+  }
+
+  //! \brief Copy the published values to out, which has room for count
+  //! values, without locking.
+  void loadMirror(T* out) const
+  {
+    uint64_t buf[maxLockFreeBytes / sizeof(uint64_t)];
+    unsigned seq0, seq1;
+    do {
+      seq0 = mirrorSeq.load(std::memory_order_acquire);
+      for (size_t i=0; i<mirrorWords; i++)
+	buf[i] = mirror[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      seq1 = mirrorSeq.load(std::memory_order_relaxed);
+    } while ((seq0 & 1) || seq0 != seq1);
+    memcpy((void*)out, buf, count * sizeof(T));
+  }
+
   //! \brief throw std::runtime_errror with appropriate message
   //! in case this controls ALSA type is not the required type.
   void checkType(snd_ctl_elem_type_t required_type, const std::string& type_name)
@@ -755,10 +1074,50 @@ class SndAnyControl: public SndControl {
 			       + type_name + " control element.\n");
   }
 
+  //! \brief Convert the values in ctl into the value cache, using
+  //! getter(ctl, channel) (like snd_ctl_elem_value_get_int() etc...).
+  //! The CacheLocker must be held.
+  //!
+  //! Getter is a template parameter, typically a lambda, rather than a
+  //! std::function, so the per channel loop is resolved and inlined at
+  //! compile time.
+  template<typename Getter>
+  void getValues(snd_ctl_elem_value_t* ctl, Getter getter)
+  {
+    uint64_t changed = val.size() != count ? allChannels() : 0;
+    val.resize(count);
+    for (unsigned i=0; i<count; i++) {
+      T v = getter(ctl, i);
+      if (memcmp((const void*)&v, (const void*)&val[i], sizeof(T)) != 0) {
+	val[i] = v;
+	changed |= channelBit(i);
+      }
+    }
+    changedMask |= changed;
+  }
+
+  //! \brief Convert the cached values into ctl, using
+  //! setter(ctl, channel, value) (like snd_ctl_elem_value_set_int()
+  //! etc...). Throws if valid(value) is false for a value. The
+  //! CacheLocker must be held.
+  template<typename Setter, typename Valid>
+  void setValues(snd_ctl_elem_value_t* ctl, Setter setter, Valid valid) const
+  {
+    for (unsigned i=0; i<count; i++) {
+      if (!valid(val[i]))
+	throw std::runtime_error("SndControl '" + name
+				 + "' on card '" + getCardName()
+				 + "' channel " + std::to_string(i)
+				 + " value " + to_string(val[i])
+				 + " out of range.\n");
+      setter(ctl, i, val[i]);
+    }
+  }
+
   //! \brief Read element values from driver, using the provided
-  //! getter() function (like snd_ctl_elem_value_get_int() etc...).
-  void read(std::function<T(snd_ctl_elem_value_t* ctl,
-			    unsigned channel)> getter)
+  //! getter() function. See getValues().
+  template<typename Getter>
+  void read(Getter getter)
   {
     if (!isReadable())
       throw std::runtime_error("SndControl '" + name
@@ -770,19 +1129,17 @@ class SndAnyControl: public SndControl {
     SndCheckErr(snd_hctl_elem_read(elem, ctl), "hctl_elem_read");
 
     CacheLocker g(this);
-    val.resize(count);
-    for (unsigned i=0; i<count; i++)
-      val[i] = getter(ctl, i);
+    getValues(ctl, getter);
+    publish();
   }
 
   virtual void read(void) =0;
 
   //! \brief Write cached element values to driver using the provided
-  //! setter() function (like snd_ctl_elem_value_set_int() etc...).
-  //! Performs value range checking with valid().
-  void write(std::function<void(snd_ctl_elem_value_t* ctl, unsigned channel,
-				T value)> setter,
-	     std::function<bool(T value)> valid)
+  //! setter() function. Performs value range checking with valid().
+  //! See setValues().
+  template<typename Setter, typename Valid>
+  void write(Setter setter, Valid valid)
   {
     if (!isWritable())
       throw std::runtime_error("SndControl '" + name
@@ -792,18 +1149,34 @@ class SndAnyControl: public SndControl {
     snd_ctl_elem_value_t *ctl;
     snd_ctl_elem_value_alloca(&ctl);
 
+    // In write-through mode, keep the cache locked until the echo is
+    // recorded, so the event thread can not handle the echo before.
+    const bool through = writeThrough && mirror && !isVolatile();
+    std::unique_lock<std::recursive_mutex> hold(rmtx, std::defer_lock);
+    if (through) hold.lock();
+
+    uint64_t changed = allChannels();
     { CacheLocker g(this); 
-    for (unsigned i=0; i<count; i++) {
-      if (!valid(val[i]))
-	throw std::runtime_error("SndControl '" + name
-				 + "' on card '" + getCardName()
-				 + "' channel " + std::to_string(i)
-				 + " value " + to_string(val[i])
-				 + " out of range.\n");
-      setter(ctl, i, val[i]);
-    }}
+      setValues(ctl, setter, valid);
+      if (mirror) {
+	// Channels that differ from the values last read or written.
+	T published[maxLockFreeBytes / sizeof(T)];
+	loadMirror(published);
+	changed = 0;
+	for (unsigned i=0; i<count; i++)
+	  if (memcmp((const void*)&published[i], (const void*)&val[i], sizeof(T)) != 0)
+	    changed |= channelBit(i);
+      }
+    }
     
     SndCheckErr(snd_hctl_elem_write(elem, ctl), "hctl_elem_write");  
+
+    CacheLocker g(this);
+    // The driver notifies only actual changes.
+    if (through && changed)
+      writeSeq++;
+    changedMask |= changed;
+    publish();
   }
 
   virtual void write(void) =0;
@@ -813,16 +1186,28 @@ class SndAnyControl: public SndControl {
 
   virtual void onElemEvent(unsigned mask)
   {
-    if ((mask & SND_CTL_EVENT_MASK_INFO) && onInfoChange)
-      onInfoChange();
-    if ((mask & SND_CTL_EVENT_MASK_TLV) && onTlvChange)
-      onTlvChange();
+    if (mask & SND_CTL_EVENT_MASK_INFO) {
+      if (onInfoChange) onInfoChange();
+      infoSubscribers.call();
+    }
+    if (mask & SND_CTL_EVENT_MASK_TLV) {
+      if (onTlvChange) onTlvChange();
+      tlvSubscribers.call();
+    }
     if ((mask & SND_CTL_EVENT_MASK_VALUE)) {
-      if (isReadable())
-	read();
-      if (onValueChange) {
+      if (!isReadable()) {
 	CacheLocker g(this);
-	onValueChange();
+	changedMask = allChannels();
+      } else if (!consumeEcho())
+	read();
+      CacheLocker g(this);
+      uint64_t changed = changedMask;
+      changedMask = 0;
+      if (changed || alwaysNotify) {
+	if (onValueChange) onValueChange();
+	if (onChannelChange) onChannelChange(changed);
+	valueSubscribers.call();
+	channelSubscribers.call(changed);
       }
     }
   }
@@ -835,6 +1220,12 @@ class SndAnyControl: public SndControl {
     checkType(required_type, type_name);
     val.resize(count);
 
+    if (count * sizeof(T) <= maxLockFreeBytes) {
+      mirrorWords = (count * sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+      mirror.reset(new std::atomic<uint64_t>[mirrorWords]);
+      publish();
+    }
+
     snd_hctl_elem_set_callback_private(elem, this);
     snd_hctl_elem_set_callback(elem, SndControl::_elem_cb);
   }
@@ -850,6 +1241,39 @@ class SndAnyControl: public SndControl {
     return val;
   }
   
+  //! \brief Returns a consistent copy of the values last read from or
+  //! written to the driver. Lock-free if isLockFree().
+  const std::vector<T> load(void) const
+  {
+    std::vector<T> v(count);
+    if (mirror) {
+      loadMirror(v.data());
+    } else {
+      CacheLocker g(const_cast<SndAnyControl*>(this));
+      v = val;
+    }
+    return v;
+  }
+
+  //! \brief Same, for a single channel.
+  const T load(unsigned channel) const
+  {
+    checkChannel(channel);
+    if (!mirror) {
+      CacheLocker g(const_cast<SndAnyControl*>(this));
+      return val[channel];
+    }
+    T v[maxLockFreeBytes / sizeof(T) + 1];
+    loadMirror(v);
+    return v[channel];
+  }
+
+  //! \brief Whether or not load() is lock-free for this control.
+  bool isLockFree(void) const
+  {
+    return mirror != nullptr;
+  }
+
   //! \brief Set the first channels value and write to driver.
   //! \note The value may be changed by another thread in between setting
   //! the value here, and writing it. If this is not desirable, protect set()
@@ -1002,7 +1426,9 @@ public:
 
   void read(void) override
   {
-    SndAnyControl::read(snd_ctl_elem_value_get_boolean);
+    SndAnyControl::read([](snd_ctl_elem_value_t* ctl, unsigned idx) {
+	return snd_ctl_elem_value_get_boolean(ctl, idx);
+      });
   }
 
   void write(void) override
@@ -1014,7 +1440,7 @@ public:
       [](snd_ctl_elem_value_t* ctl, unsigned idx, int value){
 	snd_ctl_elem_value_set_boolean(ctl, idx, value);
       },
-      [](int v){return true;} );
+      [](int v){return true;});
   }
 };
 
@@ -1023,6 +1449,26 @@ public:
 //! See \ref controlplusplus page for more details.
 class SndIntControl: public SndAnyControl<long> {
 protected:
+  // dB conversion data is read once from the element TLV, and reloaded
+  // only after a SND_CTL_EVENT_MASK_TLV event. Converting then does not
+  // cost a TLV read per value, as the ALSA conversion functions used by
+  // SndControl do.
+  mutable std::vector<unsigned int> dbTlvData; //!< TLV data read from the driver.
+  mutable unsigned int* dbTlv { nullptr };     //!< dB info within dbTlvData.
+  mutable std::vector<long> dbTable;           //!< dB gain per raw value, for small ranges.
+  mutable int dbError { 0 };                   //!< Negative error code if no dB info.
+  mutable std::atomic<bool> dbValid {false};   //!< dB conversion data up to date?
+
+  //! \brief (Re)load the dB conversion data from the driver if invalidated.
+  void loaddB(void) const;
+
+  void onElemEvent(unsigned mask) override
+  {
+    if (mask & (SND_CTL_EVENT_MASK_TLV | SND_CTL_EVENT_MASK_INFO))
+      dbValid = false;
+    SndAnyControl::onElemEvent(mask);
+  }
+
   std::ostream& print(std::ostream& s) const override
   {
     for (auto v: val)
@@ -1057,9 +1503,40 @@ public:
     *step = snd_ctl_elem_info_get_step(info);
   }
 
+  //! \brief Max. value range for which a raw value to dB gain table is
+  //! built.
+  static const long maxdBTableSize { 4096 };
+
+  //! \brief Max. TLV data size read, in words.
+  static const size_t maxTlvWords { 65536 };
+
+  //! \brief Same as SndControl::getdBRange(), from the cached TLV data.
+  int getdBRange(long* min, long* max) const override;
+
+  //! \brief Same as SndControl::convertTodB(), from the cached TLV data.
+  int convertTodB(long volume, long* db_gain) const override;
+
+  //! \brief Same as SndControl::convertFromdB(), from the cached TLV data.
+  int convertFromdB(long db_gain, long* volume, int xdir) const override;
+
+  //! \brief Convert the cached values of all channels to dB gain, in
+  //! 0.01 dB units, into db. Returns 0 if succesful, and a negative error
+  //! code if the control element offers no dB TLV data.
+  int valuesTodB(std::vector<long>& db) const;
+
+  //! \brief Convert dB gains in 0.01 dB units to raw values, assign them
+  //! to the cache and write to the driver. xdir determines the direction
+  //! of rounding: up if positive, down if negative. Like set(), the
+  //! number of values is limited by count and db.size(). Returns 0 if
+  //! succesful, and a negative error code if the control element offers no
+  //! dB TLV data, without writing.
+  int setdB(const std::vector<long>& db, int xdir =0);
+
   void read(void) override
   {
-    SndAnyControl::read(snd_ctl_elem_value_get_integer);
+    SndAnyControl::read([](snd_ctl_elem_value_t* ctl, unsigned idx) {
+	return snd_ctl_elem_value_get_integer(ctl, idx);
+      });
   }
 
   void write(void) override
@@ -1067,7 +1544,9 @@ public:
     long m, M, step;
     getRange(&m, &M, &step);
         
-    SndAnyControl::write(snd_ctl_elem_value_set_integer,
+    SndAnyControl::write([](snd_ctl_elem_value_t* ctl, unsigned idx, long v) {
+			   snd_ctl_elem_value_set_integer(ctl, idx, v);
+			 },
 			 [m,M,step] (long v) {
 			   return ((m==0 && M==0) || (v>=m && v<=M))
 			     && (step==0 || (v-m)%step==0);
@@ -1116,7 +1595,9 @@ public:
   
   void read(void) override
   {
-    SndAnyControl::read(snd_ctl_elem_value_get_integer64);
+    SndAnyControl::read([](snd_ctl_elem_value_t* ctl, unsigned idx) {
+	return snd_ctl_elem_value_get_integer64(ctl, idx);
+      });
   }
 
   void write(void) override
@@ -1124,7 +1605,9 @@ public:
     long long m, M, step;
     getRange(&m, &M, &step);
         
-    SndAnyControl::write(snd_ctl_elem_value_set_integer64,
+    SndAnyControl::write([](snd_ctl_elem_value_t* ctl, unsigned idx, long long v) {
+			   snd_ctl_elem_value_set_integer64(ctl, idx, v);
+			 },
 			 [m,M,step] (long long v) {
 			   return ((m==0 && M==0) || (v>=m && v<=M))
 			     && (step==0 || (v-m)%step==0);
@@ -1137,6 +1620,28 @@ public:
 //! See \ref controlplusplus page for more details.
 class SndEnumControl: public SndAnyControl<unsigned> {
 protected:
+  // Enumerated item labels are loaded once into a single string table,
+  // and reloaded only after a SND_CTL_EVENT_MASK_INFO event. Looking up
+  // labels then does not cost an snd_hctl_elem_info() ioctl. Each INFO
+  // event bumps labelGen. The table is up to date if it was loaded at the
+  // current generation: an event arriving while loading leaves it stale.
+  mutable std::mutex labelMtx;               //!< Protects the members below. Taken after the CacheLocker, if any.
+  mutable std::string labelTable;            //!< NUL-terminated labels, back to back.
+  mutable std::vector<unsigned> labelOffset; //!< Start of each label in labelTable.
+  mutable unsigned labelsLoaded { 0 };       //!< labelGen the table was loaded at.
+  mutable std::atomic<unsigned> labelGen {1}; //!< Bumped on each INFO event.
+
+  //! \brief (Re)load the label table from the driver if stale. labelMtx
+  //! must be held.
+  void loadLabels(void) const;
+
+  void onElemEvent(unsigned mask) override
+  {
+    if (mask & SND_CTL_EVENT_MASK_INFO)
+      labelGen++;
+    SndAnyControl::onElemEvent(mask);
+  }
+
   std::ostream& print(std::ostream& s) const override
   {
     for (unsigned i=0; i<count; i++)
@@ -1155,44 +1660,58 @@ public:
 		 Interface iface =CARD,
 		 unsigned index =0)
     : SndAnyControl(card, Find(card, name, iface, index),
-		    SND_CTL_ELEM_TYPE_ENUMERATED, "enumerated") { if (isReadable()) read(); }
+		    SND_CTL_ELEM_TYPE_ENUMERATED, "enumerated")
+  {
+    // Load the labels now rather than on first use, e.g. by the GUI.
+    {std::lock_guard<std::mutex> lock(labelMtx);
+      loadLabels();}
+    if (isReadable()) read();
+  }
 
   SndEnumControl(const class SndCard* card,
 		 snd_hctl_elem_t* elem)
     : SndAnyControl(card, elem,  
-		    SND_CTL_ELEM_TYPE_ENUMERATED, "enumerated") { if (isReadable()) read(); }  
-  
-  //! \brief Return the number of enum items.
-  unsigned getEnumCount(void) const
+		    SND_CTL_ELEM_TYPE_ENUMERATED, "enumerated")
   {
-    return snd_ctl_elem_info_get_items(info);
+    {std::lock_guard<std::mutex> lock(labelMtx);  // as above
+      loadLabels();}
+    if (isReadable()) read();
   }
   
-  //! \brief Return label string for enum value.
-  const std::string getEnumLabel(unsigned value) const
+  //! \brief Return the number of enum items, from the label table.
+  unsigned getEnumCount(void) const
   {
-    snd_ctl_elem_info_set_item(info, value);
-    SndCheckErr(snd_hctl_elem_info(elem, info), "hctl_elem_info");
-    return std::string(snd_ctl_elem_info_get_item_name(info));
+    std::lock_guard<std::mutex> lock(labelMtx);
+    loadLabels();
+    return labelOffset.size();
   }
+  
+  //! \brief Return label string for enum value, from the label table.
+  //! Values past the last item get the label of the last item, as the
+  //! driver reports them. Returns an empty string if there are no items.
+  const std::string getEnumLabel(unsigned value) const;
 
-  //! \brief Return label string for the current value in channel i
+  //! \brief Return label string for the value in channel i, as load()
+  //! returns it.
   const std::string label(int i =0) const
   {
-    checkChannel(i);
-    return getEnumLabel(val[i]);
+    return getEnumLabel(load(i));
   }
 
   void read(void) override
   {
-    SndAnyControl::read(snd_ctl_elem_value_get_enumerated);
+    SndAnyControl::read([](snd_ctl_elem_value_t* ctl, unsigned idx) {
+	return snd_ctl_elem_value_get_enumerated(ctl, idx);
+      });
   }
 
   void write(void) override
   {
     unsigned count = getEnumCount();
     
-    SndAnyControl::write(snd_ctl_elem_value_set_enumerated,
+    SndAnyControl::write([](snd_ctl_elem_value_t* ctl, unsigned idx, unsigned v) {
+			   snd_ctl_elem_value_set_enumerated(ctl, idx, v);
+			 },
 			 [count] (unsigned value) { return value<count; }
 			 );
   }
@@ -1232,12 +1751,16 @@ public:
 
   void read(void) override
   {
-    SndAnyControl::read(snd_ctl_elem_value_get_byte);
+    SndAnyControl::read([](snd_ctl_elem_value_t* ctl, unsigned idx) {
+	return snd_ctl_elem_value_get_byte(ctl, idx);
+      });
   }
 
   void write(void) override
   {
-    SndAnyControl::write(snd_ctl_elem_value_set_byte,
+    SndAnyControl::write([](snd_ctl_elem_value_t* ctl, unsigned idx, unsigned char v) {
+			   snd_ctl_elem_value_set_byte(ctl, idx, v);
+			 },
 			 [] (unsigned char v) { return true; });
   }
 };
@@ -0,0 +1,676 @@
+/*! \file SndSimCard.cpp
+ *! \brief In-process simulated ALSA sound card, for driving SndCard and
+ *! SndControl without hardware.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "SndSimCard.h"
+
+#include <alsa/control_external.h>
+
+//! \brief Open control handle on a simulated card. ext must be the first
+//! member: it is what ALSA hands to the plugin callbacks.
+struct SndSimCard::Handle {
+  snd_ctl_ext_t ext;
+  SndSimCard* card { nullptr };
+  int evfd { -1 };                 //!< Readable while events are pending.
+  bool subscribed { false };       //!< Events requested?
+  std::deque<std::pair<size_t, unsigned>> events;  //!< Pending (key, mask).
+};
+
+//! \brief ALSA external control plugin callbacks. ext->private_data
+//! points to the SndSimCard::Handle.
+struct SndSimCardCallbacks {
+  typedef SndSimCard::Handle Handle;
+  typedef SndSimCard::Elem Elem;
+
+  static Handle* handle(snd_ctl_ext_t* ext)
+  {
+    return (Handle*)ext->private_data;
+  }
+
+  static SndSimCard* card(snd_ctl_ext_t* ext)
+  {
+    return handle(ext)->card;
+  }
+
+  // Returns the element for key, or nullptr if key is invalid. Card
+  // mtx must be held.
+  static Elem* elem(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key)
+  {
+    SndSimCard* c = card(ext);
+    return key < c->elems.size() ? &c->elems[key] : nullptr;
+  }
+
+  static void drain(Handle* h)
+  {
+    uint64_t cnt;
+    if (read(h->evfd, &cnt, sizeof(cnt)) < 0) { /* nothing pending */ }
+  }
+
+  static void close(snd_ctl_ext_t* ext)
+  {
+    Handle* h = handle(ext);
+    {
+      std::lock_guard<std::mutex> lock(h->card->mtx);
+      auto& handles = h->card->handles;
+      handles.erase(std::remove(handles.begin(), handles.end(), h),
+		    handles.end());
+    }
+    ::close(h->evfd);
+    delete h;
+  }
+
+  static int elem_count(snd_ctl_ext_t* ext)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    return card(ext)->elems.size();
+  }
+
+  static int elem_list(snd_ctl_ext_t* ext, unsigned offset,
+		       snd_ctl_elem_id_t* id)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    Elem* e = elem(ext, offset);
+    if (!e)
+      return -EINVAL;
+    snd_ctl_elem_id_set_interface(id, e->iface);
+    snd_ctl_elem_id_set_name(id, e->name.c_str());
+    snd_ctl_elem_id_set_index(id, e->index);
+    return 0;
+  }
+
+  static snd_ctl_ext_key_t find_elem(snd_ctl_ext_t* ext,
+				     const snd_ctl_elem_id_t* id)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    long key = card(ext)->find(snd_ctl_elem_id_get_name(id),
+			       snd_ctl_elem_id_get_index(id),
+			       snd_ctl_elem_id_get_interface(id));
+    return key < 0 ? SND_CTL_EXT_KEY_NOT_FOUND : (snd_ctl_ext_key_t)key;
+  }
+
+  static int get_attribute(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			   int* type, unsigned* acc, unsigned* count)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    Elem* e = elem(ext, key);
+    if (!e)
+      return -ENOENT;
+    *type = e->type;
+    *acc = ((e->access & SndSimCard::READ) ? SND_CTL_EXT_ACCESS_READ : 0)
+      | ((e->access & SndSimCard::WRITE) ? SND_CTL_EXT_ACCESS_WRITE : 0)
+      | ((e->access & SndSimCard::VOLATILE) ? SND_CTL_EXT_ACCESS_VOLATILE : 0);
+    *count = e->count;
+    return 0;
+  }
+
+  static int get_integer_info(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			      long* imin, long* imax, long* istep)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    Elem* e = elem(ext, key);
+    if (!e)
+      return -ENOENT;
+    *imin = e->min; *imax = e->max; *istep = e->step;
+    return 0;
+  }
+
+  static int get_integer64_info(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+				int64_t* imin, int64_t* imax, int64_t* istep)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    Elem* e = elem(ext, key);
+    if (!e)
+      return -ENOENT;
+    *imin = e->min; *imax = e->max; *istep = e->step;
+    return 0;
+  }
+
+  static int get_enumerated_info(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+				 unsigned* items)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    Elem* e = elem(ext, key);
+    if (!e)
+      return -ENOENT;
+    *items = e->labels.size();
+    return 0;
+  }
+
+  static int get_enumerated_name(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+				 unsigned item, char* name, size_t name_max_len)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    Elem* e = elem(ext, key);
+    if (!e || item >= e->labels.size())
+      return -EINVAL;
+    snprintf(name, name_max_len, "%s", e->labels[item].c_str());
+    return 0;
+  }
+
+  // Copies the numeric values of element key to value.
+  template<typename T>
+  static int readNumeric(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key, T* value)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    Elem* e = elem(ext, key);
+    if (!e)
+      return -ENOENT;
+    std::copy(e->values.begin(), e->values.end(), value);
+    return 0;
+  }
+
+  // Assigns value to the numeric values of element key, on behalf of a
+  // client.
+  template<typename T>
+  static int writeNumeric(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key, T* value)
+  {
+    SndSimCard* c = card(ext);
+    std::lock_guard<std::mutex> lock(c->mtx);
+    Elem* e = elem(ext, key);
+    if (!e)
+      return -ENOENT;
+    if (!(e->access & SndSimCard::WRITE))
+      return -EPERM;
+    std::vector<long long> v(value, value + e->count);
+    int rc = c->assign(key, v.data());
+    if (rc > 0)
+      c->onChange(key);
+    return rc;
+  }
+
+  static int read_integer(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			  long* value)
+  {
+    return readNumeric(ext, key, value);
+  }
+
+  static int read_integer64(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			    int64_t* value)
+  {
+    return readNumeric(ext, key, value);
+  }
+
+  static int read_enumerated(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			     unsigned* items)
+  {
+    return readNumeric(ext, key, items);
+  }
+
+  static int read_bytes(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			unsigned char* data, size_t max_bytes)
+  {
+    std::lock_guard<std::mutex> lock(card(ext)->mtx);
+    Elem* e = elem(ext, key);
+    if (!e)
+      return -ENOENT;
+    memcpy(data, e->bytes.data(), std::min(max_bytes, e->bytes.size()));
+    return 0;
+  }
+
+  static int read_iec958(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			 snd_aes_iec958_t* iec958)
+  {
+    return read_bytes(ext, key, (unsigned char*)iec958, sizeof(*iec958));
+  }
+
+  static int write_integer(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			   long* value)
+  {
+    return writeNumeric(ext, key, value);
+  }
+
+  static int write_integer64(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			     int64_t* value)
+  {
+    return writeNumeric(ext, key, value);
+  }
+
+  static int write_enumerated(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			      unsigned* items)
+  {
+    return writeNumeric(ext, key, items);
+  }
+
+  static int write_bytes(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			 unsigned char* data, size_t max_bytes)
+  {
+    SndSimCard* c = card(ext);
+    std::lock_guard<std::mutex> lock(c->mtx);
+    Elem* e = elem(ext, key);
+    if (!e)
+      return -ENOENT;
+    if (!(e->access & SndSimCard::WRITE))
+      return -EPERM;
+    if (max_bytes < e->bytes.size())
+      return -EINVAL;
+    int rc = c->assign(key, data);
+    if (rc > 0)
+      c->onChange(key);
+    return rc;
+  }
+
+  static int write_iec958(snd_ctl_ext_t* ext, snd_ctl_ext_key_t key,
+			  snd_aes_iec958_t* iec958)
+  {
+    return write_bytes(ext, key, (unsigned char*)iec958, sizeof(*iec958));
+  }
+
+  static void subscribe_events(snd_ctl_ext_t* ext, int subscribe)
+  {
+    Handle* h = handle(ext);
+    std::lock_guard<std::mutex> lock(h->card->mtx);
+    h->subscribed = subscribe;
+    if (!subscribe) {
+      h->events.clear();
+      drain(h);
+    }
+  }
+
+  static int read_event(snd_ctl_ext_t* ext, snd_ctl_elem_id_t* id,
+			unsigned* event_mask)
+  {
+    Handle* h = handle(ext);
+    std::lock_guard<std::mutex> lock(h->card->mtx);
+    if (h->events.empty()) {
+      drain(h);
+      return -EAGAIN;
+    }
+
+    auto event = h->events.front();
+    h->events.pop_front();
+    if (h->events.empty())
+      drain(h);
+
+    const Elem& e = h->card->elems[event.first];
+    snd_ctl_elem_id_set_numid(id, event.first+1);
+    snd_ctl_elem_id_set_interface(id, e.iface);
+    snd_ctl_elem_id_set_name(id, e.name.c_str());
+    snd_ctl_elem_id_set_index(id, e.index);
+    *event_mask = event.second;
+    return 1;
+  }
+
+  static const snd_ctl_ext_callback_t table;
+};
+
+const snd_ctl_ext_callback_t SndSimCardCallbacks::table = {
+  .close               = SndSimCardCallbacks::close,
+  .elem_count          = SndSimCardCallbacks::elem_count,
+  .elem_list           = SndSimCardCallbacks::elem_list,
+  .find_elem           = SndSimCardCallbacks::find_elem,
+  .free_key            = nullptr,
+  .get_attribute       = SndSimCardCallbacks::get_attribute,
+  .get_integer_info    = SndSimCardCallbacks::get_integer_info,
+  .get_integer64_info  = SndSimCardCallbacks::get_integer64_info,
+  .get_enumerated_info = SndSimCardCallbacks::get_enumerated_info,
+  .get_enumerated_name = SndSimCardCallbacks::get_enumerated_name,
+  .read_integer        = SndSimCardCallbacks::read_integer,
+  .read_integer64      = SndSimCardCallbacks::read_integer64,
+  .read_enumerated     = SndSimCardCallbacks::read_enumerated,
+  .read_bytes          = SndSimCardCallbacks::read_bytes,
+  .read_iec958         = SndSimCardCallbacks::read_iec958,
+  .write_integer       = SndSimCardCallbacks::write_integer,
+  .write_integer64     = SndSimCardCallbacks::write_integer64,
+  .write_enumerated    = SndSimCardCallbacks::write_enumerated,
+  .write_bytes         = SndSimCardCallbacks::write_bytes,
+  .write_iec958        = SndSimCardCallbacks::write_iec958,
+  .subscribe_events    = SndSimCardCallbacks::subscribe_events,
+  .read_event          = SndSimCardCallbacks::read_event,
+  .poll_descriptors_count = nullptr,
+  .poll_descriptors    = nullptr,
+  .poll_revents        = nullptr,
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+SndSimCard::SndSimCard(const std::string& _name,
+		       const std::string& _driver,
+		       const std::string& _longName)
+  : name(_name)
+  , driver(_driver)
+  , longName(_longName)
+{
+  SndCard::addBackend(this);
+}
+
+SndSimCard::~SndSimCard()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    simStop = true;
+  }
+  simCond.notify_all();
+  if (simThread.joinable())
+    simThread.join();
+
+  SndCard::removeBackend(this);
+}
+
+long SndSimCard::find(const std::string& name, unsigned index, int iface) const
+{
+  for (size_t key=0; key<elems.size(); key++) {
+    const Elem& e = elems[key];
+    if (e.name == name && e.index == index && (iface < 0 || e.iface == iface))
+      return key;
+  }
+  return -1;
+}
+
+size_t SndSimCard::lookup(const std::string& name, unsigned index) const
+{
+  long key = find(name, index);
+  if (key < 0)
+    throw std::runtime_error("SndSimCard '" + this->name + "': no element '"
+			     + name + "' index " + std::to_string(index)
+			     + ".\n");
+  return key;
+}
+
+SndSimCard::Elem& SndSimCard::add(const std::string& name, unsigned index,
+				  snd_ctl_elem_iface_t iface,
+				  snd_ctl_elem_type_t type,
+				  unsigned count, int access)
+{
+  if (find(name, index) >= 0)
+    throw std::runtime_error("SndSimCard '" + this->name + "': element '"
+			     + name + "' index " + std::to_string(index)
+			     + " exists already.\n");
+
+  elems.emplace_back();
+  Elem& e = elems.back();
+  e.name = name;
+  e.iface = iface;
+  e.index = index;
+  e.type = type;
+  e.count = count;
+  e.access = access;
+  e.min = e.max = e.step = 0;
+  if (type == SND_CTL_ELEM_TYPE_BYTES)
+    e.bytes.resize(count);
+  else if (type == SND_CTL_ELEM_TYPE_IEC958)
+    e.bytes.resize(count * sizeof(snd_aes_iec958_t));
+  else
+    e.values.resize(count);
+
+  notify(elems.size()-1, SND_CTL_EVENT_MASK_ADD);
+  return e;
+}
+
+void SndSimCard::addBool(const std::string& name, unsigned count,
+			 int access, unsigned index, snd_ctl_elem_iface_t iface)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  Elem& e = add(name, index, iface, SND_CTL_ELEM_TYPE_BOOLEAN, count, access);
+  e.max = 1;
+}
+
+void SndSimCard::addInt(const std::string& name, unsigned count,
+			long min, long max, long step,
+			int access, unsigned index, snd_ctl_elem_iface_t iface)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  Elem& e = add(name, index, iface, SND_CTL_ELEM_TYPE_INTEGER, count, access);
+  e.min = min; e.max = max; e.step = step;
+  std::fill(e.values.begin(), e.values.end(), min);
+}
+
+void SndSimCard::addInt64(const std::string& name, unsigned count,
+			  long long min, long long max, long long step,
+			  int access, unsigned index, snd_ctl_elem_iface_t iface)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  Elem& e = add(name, index, iface, SND_CTL_ELEM_TYPE_INTEGER64, count, access);
+  e.min = min; e.max = max; e.step = step;
+  std::fill(e.values.begin(), e.values.end(), min);
+}
+
+void SndSimCard::addEnum(const std::string& name, unsigned count,
+			 const std::vector<std::string>& labels,
+			 int access, unsigned index, snd_ctl_elem_iface_t iface)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  Elem& e = add(name, index, iface, SND_CTL_ELEM_TYPE_ENUMERATED, count, access);
+  e.labels = labels;
+  e.max = labels.size() - 1;
+}
+
+void SndSimCard::addBytes(const std::string& name, unsigned count,
+			  int access, unsigned index, snd_ctl_elem_iface_t iface)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  add(name, index, iface, SND_CTL_ELEM_TYPE_BYTES, count, access);
+}
+
+void SndSimCard::addIec958(const std::string& name,
+			   int access, unsigned index, snd_ctl_elem_iface_t iface)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  add(name, index, iface, SND_CTL_ELEM_TYPE_IEC958, 1, access);
+}
+
+void SndSimCard::notify(size_t key, unsigned mask)
+{
+  static const uint64_t one = 1;
+  for (Handle* h: handles) {
+    if (!h->subscribed)
+      continue;
+
+    // Like the kernel, merge with an event already pending for the element.
+    auto it = std::find_if(h->events.begin(), h->events.end(),
+			   [key](const std::pair<size_t, unsigned>& ev)
+			   { return ev.first == key; });
+    if (it != h->events.end()) {
+      it->second |= mask;
+      continue;
+    }
+
+    h->events.emplace_back(key, mask);
+    if (write(h->evfd, &one, sizeof(one)) < 0)
+      std::cerr << "SndSimCard '" << name << "': eventfd write failed: "
+		<< strerror(errno) << "\n";
+  }
+}
+
+int SndSimCard::assign(size_t key, const long long* values)
+{
+  Elem& e = elems[key];
+  for (unsigned i=0; i<e.count; i++)
+    if (values[i] < e.min || values[i] > e.max)
+      return -EINVAL;
+
+  if (std::equal(e.values.begin(), e.values.end(), values))
+    return 0;
+  std::copy(values, values + e.count, e.values.begin());
+  if (!(e.access & VOLATILE))
+    notify(key, SND_CTL_EVENT_MASK_VALUE);
+  return 1;
+}
+
+int SndSimCard::assign(size_t key, const unsigned char* bytes)
+{
+  Elem& e = elems[key];
+  if (std::equal(e.bytes.begin(), e.bytes.end(), bytes))
+    return 0;
+  std::copy(bytes, bytes + e.bytes.size(), e.bytes.begin());
+  if (!(e.access & VOLATILE))
+    notify(key, SND_CTL_EVENT_MASK_VALUE);
+  return 1;
+}
+
+void SndSimCard::set(const std::string& name,
+		     const std::vector<long long>& values, unsigned index)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  size_t key = lookup(name, index);
+  Elem& e = elems[key];
+  if (e.values.size() != e.count || values.size() > e.count)
+    throw std::runtime_error("SndSimCard '" + this->name + "': cannot set "
+			     + std::to_string(values.size())
+			     + " numeric values on element '" + name + "'.\n");
+
+  std::vector<long long> v = e.values;
+  std::copy(values.begin(), values.end(), v.begin());
+  int rc = assign(key, v.data());
+  if (rc < 0)
+    throw std::runtime_error("SndSimCard '" + this->name
+			     + "': value out of range for element '"
+			     + name + "'.\n");
+  if (rc > 0)
+    onChange(key);
+}
+
+std::vector<long long> SndSimCard::get(const std::string& name,
+				       unsigned index) const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return elems[lookup(name, index)].values;
+}
+
+void SndSimCard::setBytes(const std::string& name,
+			  const std::vector<unsigned char>& bytes,
+			  unsigned index)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  size_t key = lookup(name, index);
+  Elem& e = elems[key];
+  if (bytes.size() != e.bytes.size())
+    throw std::runtime_error("SndSimCard '" + this->name + "': element '"
+			     + name + "' takes " + std::to_string(e.bytes.size())
+			     + " bytes.\n");
+  if (assign(key, bytes.data()) > 0)
+    onChange(key);
+}
+
+std::vector<unsigned char> SndSimCard::getBytes(const std::string& name,
+						unsigned index) const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return elems[lookup(name, index)].bytes;
+}
+
+void SndSimCard::simulate(const std::string& name, double rate, Script script,
+			  unsigned index)
+{
+  if (rate <= 0.)
+    throw std::runtime_error("SndSimCard '" + this->name
+			     + "': simulation rate must be positive.\n");
+
+  std::lock_guard<std::mutex> lock(mtx);
+  size_t key = lookup(name, index);
+  if (elems[key].values.size() != elems[key].count)
+    throw std::runtime_error("SndSimCard '" + this->name + "': element '"
+			     + name + "' is not numeric.\n");
+
+  Simulation sim;
+  sim.key = key;
+  sim.period = std::chrono::duration_cast<std::chrono::steady_clock::duration>
+    (std::chrono::duration<double>(1. / rate));
+  sim.next = std::chrono::steady_clock::now() + sim.period;
+  sim.script = script;
+  simulations.push_back(sim);
+
+  if (!simThread.joinable())
+    simThread = std::thread(&SndSimCard::simulationMain, this);
+  simCond.notify_all();
+}
+
+void SndSimCard::stopSimulations(void)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  simulations.clear();
+}
+
+void SndSimCard::simulationMain(void)
+{
+  std::unique_lock<std::mutex> lock(mtx);
+  while (!simStop) {
+    Simulation* due { nullptr };
+    for (auto& sim: simulations)
+      if (!due || sim.next < due->next)
+	due = &sim;
+
+    if (!due) {
+      simCond.wait(lock);
+      continue;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (due->next > now) {
+      // simulations may have changed when we wake up: re-evaluate.
+      simCond.wait_until(lock, due->next);
+      continue;
+    }
+
+    Elem& e = elems[due->key];
+    std::vector<long long> v = e.values;
+    due->script(v);
+    v.resize(e.count);
+    int rc = assign(due->key, v.data());
+    if (rc < 0)
+      std::cerr << "SndSimCard '" << name << "': simulated value for '"
+		<< e.name << "' out of range.\n";
+    else if (rc > 0)
+      onChange(due->key);
+
+    // Don't try to catch up after a stall.
+    due->next += due->period;
+    if (due->next < now)
+      due->next = now + due->period;
+  }
+}
+
+snd_ctl_t* SndSimCard::openCtl(const std::string& cardName, int mode)
+{
+  if (cardName != name)
+    return nullptr;
+
+  Handle* h = new Handle();
+  h->card = this;
+  h->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (h->evfd < 0) {
+    delete h;
+    SndCheckErr(-errno, "sim_eventfd");
+  }
+
+  snd_ctl_ext_t* ext = &h->ext;
+  ext->version = SND_CTL_EXT_VERSION;
+  ext->card_idx = -1;
+  snprintf(ext->id, sizeof(ext->id), "%s", "SndSim");
+  snprintf(ext->driver, sizeof(ext->driver), "%s", driver.c_str());
+  snprintf(ext->name, sizeof(ext->name), "%s", name.c_str());
+  snprintf(ext->longname, sizeof(ext->longname), "%s", longName.c_str());
+  snprintf(ext->mixername, sizeof(ext->mixername), "%s", longName.c_str());
+  ext->poll_fd = h->evfd;
+  ext->callback = &SndSimCardCallbacks::table;
+  ext->private_data = h;
+
+  int err = snd_ctl_ext_create(ext, name.c_str(), mode);
+  if (err < 0) {
+    ::close(h->evfd);
+    delete h;
+    SndCheckErr(err, "ctl_ext_create");
+  }
+
+  std::lock_guard<std::mutex> lock(mtx);
+  handles.push_back(h);
+  return ext->handle;
+}
+
+void SndSimCard::ioctl(const std::string& cardName,
+		       uint32_t request, int mode, void* pdata)
+{
+  throw std::runtime_error("SndSimCard '" + name + "' has no hwdep device.\n");
+}
@@ -0,0 +1,252 @@
+/*! \file SndSimCard.h
+ *! \brief In-process simulated ALSA sound card, for driving SndCard and
+ *! SndControl without hardware.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+/*! \page simcardplusplus Simulated sound cards
+ *
+ * SndSimCard provides a sound card that lives entirely inside the running
+ * process. It is meant for development, regression testing and
+ * benchmarking of the SndCard and SndControl classes, and of the panels
+ * built on top of them, on machines without the hardware.
+ *
+ * The simulated card is implemented with ALSA's external control plugin
+ * interface (snd_ctl_ext). It registers itself as a SndBackend. Opening a
+ * SndCard with the simulated card's name then yields a genuine snd_ctl_t
+ * handle, so SndControl objects read, write and receive change events
+ * through the regular ALSA code paths, including the shared control event
+ * handling thread.
+ *
+ * Usage
+ * -----
+ *
+ * - Construct a SndSimCard with a card name, e.g. "sim:0".
+ * - Add control elements: addBool(), addInt(), addInt64(), addEnum(),
+ *   addBytes(), addIec958(). Do so before any SndCard opens the simulated
+ *   card.
+ * - Open a SndCard with the same name and create SndControl objects as
+ *   usual.
+ * - Change values from the "driver" side with set() and setBytes().
+ *   Each actual change is notified to all open handles, like the kernel
+ *   does for a real card. Values written through a SndControl are
+ *   notified in the same way.
+ * - simulate() schedules a script that updates an element's values at a
+ *   given rate, e.g. to emulate status changes or timecode.
+ *
+ * Limitations
+ * -----------
+ *
+ * - The inter-process element lock (snd_ctl_elem_lock()) is not supported
+ *   by the external control plugin interface: SndControl::ElemLocker
+ *   fails with -ENXIO on simulated cards.
+ * - There is no hwdep device. SndCard::ioctl() calls are routed to
+ *   SndSimCard::ioctl(), which throws.
+ * - TLV data is not supported.
+ *
+ * Example
+ * -------
+ *
+ *     SndSimCard sim("sim:0");
+ *     sim.addInt("Buffer Size", 1, 32, 8192, 0, SndSimCard::READ);
+ *     sim.set("Buffer Size", {256});
+ *     sim.simulate("Buffer Size", 10.,
+ *                  [](std::vector<long long>& v) { v[0] ^= 256^512; });
+ *
+ *     SndCard card("sim:0");
+ *     SndIntControl bufferSize(&card, "Buffer Size");
+ *     bufferSize.callOnValueChange([&]() { ... });
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SndCard.h"
+
+//! \brief In-process simulated sound card.
+//!
+//! See \ref simcardplusplus page.
+class SndSimCard: public SndBackend {
+public:
+  //! \brief Element access flags.
+  enum Access {
+    READ      = 1,   //!< Readable.
+    WRITE     = 2,   //!< Writable.
+    READWRITE = 3,   //!< Readable and writable.
+    VOLATILE  = 4,   //!< Value may change without notification.
+  };
+
+  //! \brief Value update script: modifies values in place. Called with
+  //! the current element values, at the simulation rate.
+  using Script = std::function<void(std::vector<long long>& values)>;
+
+protected:
+  //! \brief Simulated control element.
+  struct Elem {
+    std::string name;
+    snd_ctl_elem_iface_t iface;
+    unsigned index;
+    snd_ctl_elem_type_t type;
+    unsigned count;
+    int access;
+    long long min, max, step;              //!< INTEGER and INTEGER64 range.
+    std::vector<std::string> labels;       //!< ENUMERATED item names.
+    std::vector<long long> values;         //!< BOOLEAN, INTEGER, INTEGER64, ENUMERATED values.
+    std::vector<unsigned char> bytes;      //!< BYTES and IEC958 values.
+  };
+
+  //! \brief Scheduled value update script.
+  struct Simulation {
+    size_t key;                            //!< Element index.
+    std::chrono::steady_clock::duration period;
+    std::chrono::steady_clock::time_point next;
+    Script script;
+  };
+
+  struct Handle;                           //!< Open control handle (see .cpp).
+
+  std::string name;                        //!< Card name, e.g. "sim:0".
+  std::string driver;                      //!< Driver name, reported in card info.
+  std::string longName;                    //!< Long name, reported in card info.
+
+  //! Protects elements, handles and simulations. Held while ALSA
+  //! plugin callbacks, scripts and onChange() run.
+  mutable std::mutex mtx;
+  std::vector<Elem> elems;                 //!< Control elements. Key is index.
+  std::vector<Handle*> handles;            //!< Open control handles.
+
+  std::vector<Simulation> simulations;     //!< Scheduled scripts.
+  std::condition_variable simCond;         //!< Wakes the simulation thread.
+  std::thread simThread;                   //!< Runs scripts, started by simulate().
+  bool simStop { false };                  //!< Simulation thread termination request.
+
+  //! \brief Append an element and notify its addition. Throws if an
+  //! element with the same name and index exists already. mtx must be
+  //! held.
+  Elem& add(const std::string& name, unsigned index, snd_ctl_elem_iface_t iface,
+	    snd_ctl_elem_type_t type, unsigned count, int access);
+
+  //! \brief Look up an element by name, index and interface (any
+  //! interface if iface<0). Returns its key, or -1 if not found. mtx
+  //! must be held.
+  long find(const std::string& name, unsigned index, int iface =-1) const;
+
+  //! \brief Same, for any interface, but throws if not found. mtx must
+  //! be held.
+  size_t lookup(const std::string& name, unsigned index) const;
+
+  //! \brief Queue a change event with given SND_CTL_EVENT_MASK_xxx bits
+  //! for element key on all subscribed handles. mtx must be held.
+  void notify(size_t key, unsigned mask);
+
+  //! \brief Validate and assign numeric values to element key, notifying
+  //! a change if any. Returns 1 if values changed, 0 if not, -EINVAL
+  //! if a value is out of range. mtx must be held.
+  int assign(size_t key, const long long* values);
+
+  //! \brief Same, for BYTES and IEC958 elements.
+  int assign(size_t key, const unsigned char* bytes);
+
+  //! \brief Called after the values of element key changed, through a
+  //! client write, set(), setBytes() or a simulation script. Override
+  //! to emulate driver side effects, e.g. on dependent elements: assign()
+  //! does not call onChange(). mtx is held.
+  virtual void onChange(size_t key) {}
+
+  //! \brief Simulation thread main loop.
+  void simulationMain(void);
+
+  friend struct SndSimCardCallbacks;      //!< ALSA external control plugin callbacks.
+
+public:
+  //! \brief Constructor: creates a card without elements with given
+  //! card name, driver name and long name, and registers it as SndCard
+  //! backend.
+  SndSimCard(const std::string& name ="sim:0",
+	     const std::string& driver ="SndSim",
+	     const std::string& longName ="Simulated sound card");
+
+  //! \brief Destructor: stops simulations and unregisters the backend.
+  //! All SndCard objects opened on this card must be destroyed first.
+  virtual ~SndSimCard();
+
+  //! \brief Get the card name.
+  const std::string& getName(void) const { return name; }
+
+  //! \brief Add a BOOLEAN element with count values.
+  void addBool(const std::string& name, unsigned count =1,
+	       int access =READWRITE, unsigned index =0,
+	       snd_ctl_elem_iface_t iface =SND_CTL_ELEM_IFACE_CARD);
+
+  //! \brief Add an INTEGER element with count values in range [min,max].
+  void addInt(const std::string& name, unsigned count,
+	      long min, long max, long step =0,
+	      int access =READWRITE, unsigned index =0,
+	      snd_ctl_elem_iface_t iface =SND_CTL_ELEM_IFACE_CARD);
+
+  //! \brief Add an INTEGER64 element with count values in range [min,max].
+  void addInt64(const std::string& name, unsigned count,
+		long long min, long long max, long long step =0,
+		int access =READWRITE, unsigned index =0,
+		snd_ctl_elem_iface_t iface =SND_CTL_ELEM_IFACE_CARD);
+
+  //! \brief Add an ENUMERATED element with count values and given item
+  //! labels.
+  void addEnum(const std::string& name, unsigned count,
+	       const std::vector<std::string>& labels,
+	       int access =READWRITE, unsigned index =0,
+	       snd_ctl_elem_iface_t iface =SND_CTL_ELEM_IFACE_CARD);
+
+  //! \brief Add a BYTES element with count values.
+  void addBytes(const std::string& name, unsigned count,
+		int access =READWRITE, unsigned index =0,
+		snd_ctl_elem_iface_t iface =SND_CTL_ELEM_IFACE_CARD);
+
+  //! \brief Add an IEC958 element.
+  void addIec958(const std::string& name,
+		 int access =READWRITE, unsigned index =0,
+		 snd_ctl_elem_iface_t iface =SND_CTL_ELEM_IFACE_CARD);
+
+  //! \brief Set the values of a BOOLEAN, INTEGER, INTEGER64 or
+  //! ENUMERATED element, from the driver side. Missing trailing values
+  //! are left unchanged. Throws if the element does not exist or a value
+  //! is out of range.
+  void set(const std::string& name, const std::vector<long long>& values,
+	   unsigned index =0);
+
+  //! \brief Get the values of a BOOLEAN, INTEGER, INTEGER64 or ENUMERATED
+  //! element.
+  std::vector<long long> get(const std::string& name, unsigned index =0) const;
+
+  //! \brief Set the values of a BYTES or IEC958 element, from the driver
+  //! side.
+  void setBytes(const std::string& name,
+		const std::vector<unsigned char>& bytes, unsigned index =0);
+
+  //! \brief Get the values of a BYTES or IEC958 element.
+  std::vector<unsigned char> getBytes(const std::string& name,
+				      unsigned index =0) const;
+
+  //! \brief Run script on the values of the named numeric element rate
+  //! times per second, notifying a change each time the script changed
+  //! the values. The first run is one period from now. Scripts run on
+  //! a simulation thread owned by the card, with the card locked: they
+  //! shall not call set(), get() or other public member functions.
+  void simulate(const std::string& name, double rate, Script script,
+		unsigned index =0);
+
+  //! \brief Stop all simulations.
+  void stopSimulations(void);
+
+  // SndBackend interface.
+  snd_ctl_t* openCtl(const std::string& cardName, int mode) override;
+  void ioctl(const std::string& cardName,
+	     uint32_t request, int mode, void* pdata) override;
+};
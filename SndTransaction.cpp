@@ -0,0 +1,80 @@
+/*! \file SndTransaction.cpp
+ *! \brief Atomic writes to several ALSA control elements, with rollback.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+#include <errno.h>
+
+#include "SndTransaction.h"
+#include "SndCard.h"
+
+void SndTransaction::commit(void)
+{
+  std::vector<std::unique_ptr<Op>> pending;
+  pending.swap(ops);
+
+  // Fixed lock order: by card name, then element numid.
+  std::vector<SndControl*> order;
+  for (auto& o: pending)
+    order.push_back(o->control());
+  std::sort(order.begin(), order.end(), [](SndControl* a, SndControl* b) {
+      if (a->getCard() != b->getCard()) {
+	const std::string an = a->getCard()->getName(), bn = b->getCard()->getName();
+	return an != bn ? an < bn : std::less<const SndCard*>()(a->getCard(), b->getCard());
+      }
+      return snd_ctl_elem_id_get_numid(a->getIdRef())
+	< snd_ctl_elem_id_get_numid(b->getIdRef());
+    });
+
+  std::vector<std::unique_ptr<SndControl::ElemLocker>> locks;
+  for (auto c: order) {
+    std::unique_ptr<SndControl::ElemLocker> lock
+      (new SndControl::ElemLocker(*c, lockTimeout));
+    int rc = lock->status();
+    if (rc == -ENXIO)
+      continue;   // no element locks on this card, e.g. a simulated card.
+    if (rc == -ETIMEDOUT)
+      throw std::runtime_error("SndTransaction: SndControl '" + c->getName()
+			       + "' on card '" + c->getCard()->getName()
+			       + "' is locked by another process.\n");
+    if (rc < 0)
+      throw std::runtime_error("SndTransaction: SndControl '" + c->getName()
+			       + "' on card '" + c->getCard()->getName()
+			       + "' can not be locked: " + snd_strerror(rc) + "\n");
+    locks.push_back(std::move(lock));
+  }
+
+  // Hold back change events until all writes are done. Declared after
+  // locks, so held back events are posted to the event handling thread
+  // before the locks are released.
+  struct Muter {
+    std::vector<SndControl*>& controls;
+    Muter(std::vector<SndControl*>& c) : controls(c)
+    {
+      for (auto c: controls) c->muteEvents();
+    }
+    ~Muter()
+    {
+      for (auto c: controls) c->unmuteEvents();
+    }
+  } muter(order);
+
+  size_t i = 0;
+  try {
+    for (; i<pending.size(); i++)
+      pending[i]->apply();
+  } catch (std::runtime_error& e) {
+    pending[i]->restoreCache();
+    while (i-- > 0) {
+      try {
+	pending[i]->rollback();
+      } catch (std::runtime_error& e2) {
+	std::cerr << "SndTransaction: rollback failed: " << e2.what();
+      }
+    }
+    throw;
+  }
+}
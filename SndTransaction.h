@@ -0,0 +1,148 @@
+/*! \file SndTransaction.h
+ *! \brief Atomic writes to several ALSA control elements, with rollback.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#ifndef _SND_TRANSACTION_H_
+#define _SND_TRANSACTION_H_
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SndControl.h"
+
+//! \brief Collects new values for several SndControl objects, and writes
+//! them all at once with commit().
+//!
+//! commit()
+//! - takes the inter-process element lock (see SndControl::ElemLocker) on
+//!   all controls, in a fixed order, so concurrent transactions on the same
+//!   controls cannot deadlock;
+//! - holds back the change events of the controls until all values are
+//!   written, so each control notifies its value change callback at most
+//!   once per transaction, from the control event handling thread, as
+//!   always;
+//! - writes the values, back to back, in the order they were set();
+//! - if a write fails, writes back the values the controls had before, in
+//!   reverse order, and throws.
+//!
+//! Elements whose card does not support the ALSA element lock (-ENXIO),
+//! e.g. simulated cards, are written without it. Any other failure to
+//! lock an element aborts the transaction.
+//!
+//! Example:
+//!
+//!     SndTransaction t;
+//!     t.set(card->preferredRef, tcoSyncChoice);
+//!     t.set(card->clockMode, 0);
+//!     t.commit();
+class SndTransaction {
+ protected:
+  //! \brief Pending write to a single control.
+  struct Op {
+    virtual ~Op() {}
+    virtual SndControl* control(void) const =0;
+    //! \brief Saves the current values and writes the new ones.
+    virtual void apply(void) =0;
+    //! \brief Writes back the saved values.
+    virtual void rollback(void) =0;
+    //! \brief Restores the saved values in the cache, without writing.
+    virtual void restoreCache(void) =0;
+  };
+
+  template<typename T>
+  struct AnyOp: public Op {
+    SndAnyControl<T>& ctl;
+    std::vector<std::pair<unsigned, T>> writes;  //!< Channel, value.
+    std::vector<T> saved;                        //!< Values before apply().
+
+    AnyOp(SndAnyControl<T>& _ctl) : ctl(_ctl) {}
+
+    SndControl* control(void) const override { return &ctl; }
+
+    void apply(void) override
+    {
+      std::vector<T> newval;
+      {
+	SndControl::CacheLocker g(ctl);
+	saved = ctl;
+	newval = saved;
+      }
+      for (auto& w: writes)
+	if (w.first < newval.size())
+	  newval[w.first] = w.second;
+      ctl.set(newval);
+    }
+
+    void rollback(void) override
+    {
+      ctl.set(saved);
+    }
+
+    void restoreCache(void) override
+    {
+      SndControl::CacheLocker g(ctl);
+      ctl = saved;
+    }
+  };
+
+  //! \brief Identity, to keep value arguments of set() from taking part
+  //! in template argument deduction: t.set(enumControl, 0) then works.
+  template<typename T> struct Value { using type = T; };
+
+  std::vector<std::unique_ptr<Op>> ops;   //!< Pending writes, in set() order.
+  std::chrono::milliseconds lockTimeout;  //!< Max. wait for each element lock.
+
+  //! \brief Find or create the pending write for ctl.
+  template<typename T>
+  AnyOp<T>& op(SndAnyControl<T>& ctl)
+  {
+    for (auto& o: ops)
+      if (o->control() == &ctl)
+	return static_cast<AnyOp<T>&>(*o);
+    ops.emplace_back(new AnyOp<T>(ctl));
+    return static_cast<AnyOp<T>&>(*ops.back());
+  }
+
+ public:
+  //! \brief Constructor. commit() waits at most lockTimeout for each element
+  //! lock.
+  SndTransaction(std::chrono::milliseconds lockTimeout =std::chrono::seconds(1))
+    : lockTimeout(lockTimeout) {}
+
+  //! \brief Set the value of channel of ctl at commit().
+  template<typename T>
+  void set(SndAnyControl<T>& ctl, const typename Value<T>::type& value,
+	   unsigned channel =0)
+  {
+    if (channel >= ctl.getCount())
+      throw std::runtime_error("SndTransaction: SndControl '" + ctl.getName()
+			       + "' channel index " + std::to_string(channel)
+			       + " out of range.\n");
+    op(ctl).writes.emplace_back(channel, value);
+  }
+
+  //! \brief Set the values of the first values.size() channels of ctl at
+  //! commit().
+  template<typename T>
+  void set(SndAnyControl<T>& ctl, const std::vector<T>& values)
+  {
+    AnyOp<T>& o = op(ctl);
+    for (unsigned i=0; i<values.size(); i++)
+      o.writes.emplace_back(i, values[i]);
+  }
+
+  //! \brief Returns whether no values have been set.
+  bool empty(void) const { return ops.empty(); }
+
+  //! \brief Write all values set, as described above, and clear the
+  //! transaction. Throws std::runtime_error if an element lock can not be
+  //! obtained, in which case nothing is written, or if a write fails, after
+  //! rolling back the writes done.
+  void commit(void);
+};
+
+#endif /* _SND_TRANSACTION_H_ */
@@ -0,0 +1,191 @@
+/*! \file StatusPollRegistry.cpp
+ *! \brief Cross-process arbitration of the HDSPe "Status Polling" rate.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#include <algorithm>
+#include <iostream>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "StatusPollRegistry.h"
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t)
+	      && std::atomic<int32_t>::is_always_lock_free,
+	      "shared memory slots need lock-free 32-bit atomics");
+
+StatusPollRegistry::StatusPollRegistry(long serial)
+  : shmName("/hdspeconf-poll-" + std::to_string(serial))
+{
+  // The last process leaving removes the segment, holding all slot
+  // locks: claim() fails meanwhile. Once removed, start over.
+  static const int maxAttempts { 10 };
+  for (int attempt=0; attempt<maxAttempts; attempt++) {
+    if (!attach())
+      return;
+    slot = claim();
+    if (linked()) {
+      if (slot || attempt == maxAttempts-1)
+	break;
+      usleep(1000);
+    }
+    slot = nullptr;
+    detach();
+  }
+  if (!slot)
+    std::cerr << "StatusPollRegistry: " << shmName << " is full.\n";
+}
+
+bool StatusPollRegistry::attach(void)
+{
+  fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    std::cerr << "StatusPollRegistry: shm_open " << shmName << " failed: "
+	      << strerror(errno) << "\n";
+    return false;
+  }
+  // Anyone able to write the segment could take the writer role and
+  // never write: only trust a segment of our own.
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_uid != geteuid()
+      || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+    std::cerr << "StatusPollRegistry: " << shmName
+	      << " belongs to another user, or is writable by others.\n";
+    close(fd); fd = -1;
+    return false;
+  }
+  // A new object is zero filled: all slots free. Concurrent creators
+  // truncate to the same size.
+  if (ftruncate(fd, sizeof(Shared)) < 0) {
+    std::cerr << "StatusPollRegistry: ftruncate " << shmName << " failed: "
+	      << strerror(errno) << "\n";
+    close(fd); fd = -1;
+    return false;
+  }
+  void* p = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    std::cerr << "StatusPollRegistry: mmap " << shmName << " failed: "
+	      << strerror(errno) << "\n";
+    close(fd); fd = -1;
+    return false;
+  }
+  shared = (Shared*)p;
+  return true;
+}
+
+void StatusPollRegistry::detach(void)
+{
+  if (shared)
+    munmap(shared, sizeof(Shared));
+  shared = nullptr;
+  if (fd >= 0)
+    close(fd);    // releases our locks.
+  fd = -1;
+}
+
+bool StatusPollRegistry::linked(void) const
+{
+  int f = shm_open(shmName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (f < 0)
+    return false;
+  struct stat ours, named;
+  bool same = fstat(fd, &ours) == 0 && fstat(f, &named) == 0
+    && ours.st_dev == named.st_dev && ours.st_ino == named.st_ino;
+  close(f);
+  return same;
+}
+
+StatusPollRegistry::~StatusPollRegistry()
+{
+  if (slot) {
+    slot->rate.store(0);
+    slot->pid.store(0);
+    // Last one out: no other process holds a slot, nor is claiming one.
+    if (tryLock(0, slotLock + maxSlots))
+      shm_unlink(shmName.c_str());
+  }
+  detach();
+}
+
+bool StatusPollRegistry::tryLock(off_t offset, off_t len) const
+{
+  struct flock fl {};
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = offset;
+  fl.l_len = len;
+  return fcntl(fd, F_OFD_SETLK, &fl) == 0;
+}
+
+bool StatusPollRegistry::lockedByOther(off_t offset) const
+{
+  struct flock fl {};
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = offset;
+  fl.l_len = 1;
+  // Our own locks do not conflict: they are reported unlocked.
+  return fcntl(fd, F_OFD_GETLK, &fl) == 0 && fl.l_type != F_UNLCK;
+}
+
+bool StatusPollRegistry::live(unsigned i) const
+{
+  const Slot& s = shared->slots[i];
+  return &s == slot || (s.pid.load() != 0 && lockedByOther(slotLock + i));
+}
+
+StatusPollRegistry::Slot* StatusPollRegistry::claim(void)
+{
+  for (unsigned i=0; i<maxSlots; i++) {
+    // Free, or left behind by a process that exited, if we get the lock.
+    if (!tryLock(slotLock + i))
+      continue;
+    Slot& s = shared->slots[i];
+    s.rate.store(0);
+    s.pid.store(getpid());
+    return &s;
+  }
+  return nullptr;
+}
+
+void StatusPollRegistry::setRate(int rate)
+{
+  if (slot)
+    slot->rate.store(rate);
+}
+
+int StatusPollRegistry::maxRate(void) const
+{
+  int max = slot ? slot->rate.load() : 0;
+  for (unsigned i=0; slot && i<maxSlots; i++)
+    if (live(i))
+      max = std::max(max, (int)shared->slots[i].rate.load());
+  return max;
+}
+
+bool StatusPollRegistry::isWriter(void)
+{
+  if (!slot)
+    return true;
+  if (!writer && tryLock(writerLock)) {
+    writer = true;
+    shared->writer.store(slot - shared->slots);
+  }
+  return writer;
+}
+
+int StatusPollRegistry::writerRate(void) const
+{
+  if (!slot)
+    return 0;
+  if (writer)
+    return slot->rate.load();
+  int32_t w = shared->writer.load();
+  if (w < 0 || w >= (int32_t)maxSlots || !lockedByOther(writerLock) || !live(w))
+    return 0;
+  return shared->slots[w].rate.load();
+}
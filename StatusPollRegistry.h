@@ -0,0 +1,111 @@
+/*! \file StatusPollRegistry.h
+ *! \brief Cross-process arbitration of the HDSPe "Status Polling" rate.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#ifndef _STATUS_POLL_REGISTRY_H_
+#define _STATUS_POLL_REGISTRY_H_
+
+#include <atomic>
+#include <string>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+//! \brief Registry, in a POSIX shared memory segment per card serial
+//! number, of the status polling rate each process wants for the card.
+//!
+//! "Status Polling" is a single driver control, shared by all processes
+//! using the card. Rather than having each of them write its own rate
+//! whenever the driver resets the control, each process registers its
+//! desired rate here. Only the elected writer writes the control, with the
+//! maximum of the registered rates.
+//!
+//! Slot ownership and the writer role are open file description locks on
+//! the segment (fcntl F_OFD_SETLK): the kernel releases them when a
+//! process exits or crashes, so slots and the writer role of dead
+//! processes are taken over by the next process asking for them. Rates
+//! are read and written lock-free.
+//!
+//! The segment is private to the user who created it. If it is not
+//! available, e.g. because it belongs to another user, available()
+//! returns false, and the caller should act alone.
+//!
+//! The last process to unregister removes the segment: it can take the
+//! locks of all slots. A process that opened the segment just before it
+//! was removed notices, and starts over with a new one.
+class StatusPollRegistry {
+ protected:
+  static const unsigned maxSlots { 32 };
+
+  struct Slot {
+    std::atomic<int32_t> pid;    //!< Registered process id, 0 if free.
+    std::atomic<int32_t> rate;   //!< Its desired rate.
+  };
+
+  struct Shared {
+    std::atomic<int32_t> writer; //!< Slot index of the last elected writer.
+    Slot slots[maxSlots];
+  };
+
+  // Locked byte offsets in the segment. They need not match the data.
+  static const off_t writerLock { 0 };     //!< Held by the elected writer.
+  static const off_t slotLock { 1 };       //!< + i: held by the owner of slot i.
+
+  std::string shmName;            //!< Shared memory object name.
+  int fd { -1 };                  //!< Open segment, holding our locks.
+  Shared* shared { nullptr };     //!< Mapped segment.
+  Slot* slot { nullptr };         //!< Our slot.
+  bool writer { false };          //!< Whether we hold the writer lock.
+
+  //! \brief Open, check and map the segment. Returns false, with fd -1,
+  //! on failure.
+  bool attach(void);
+
+  //! \brief Unmap and close the segment, releasing our locks.
+  void detach(void);
+
+  //! \brief Returns whether our segment is still the one under shmName.
+  bool linked(void) const;
+
+  //! \brief Try to lock len bytes at offset. Returns true on success or if
+  //! we hold the lock already.
+  bool tryLock(off_t offset, off_t len =1) const;
+
+  //! \brief Returns whether the byte at offset is locked by another open
+  //! file description.
+  bool lockedByOther(off_t offset) const;
+
+  //! \brief Returns whether slot i belongs to a live process.
+  bool live(unsigned i) const;
+
+  //! \brief Claim a free or stale slot. Returns nullptr if none.
+  Slot* claim(void);
+
+ public:
+  //! \brief Constructor: opens or creates the registry of the card with
+  //! given serial number, and registers this process, without rate yet.
+  StatusPollRegistry(long serial);
+
+  //! \brief Destructor: unregisters this process, and gives up the writer
+  //! role if we have it. Removes the segment if no other process is
+  //! registered.
+  ~StatusPollRegistry();
+
+  //! \brief Returns whether the registry could be set up.
+  bool available(void) const { return slot != nullptr; }
+
+  //! \brief Register our desired rate.
+  void setRate(int rate);
+
+  //! \brief Maximum desired rate of all live registered processes.
+  int maxRate(void) const;
+
+  //! \brief Returns whether this process is the elected writer. Takes
+  //! the writer role if no live process has it.
+  bool isWriter(void);
+
+  //! \brief Desired rate of the elected writer, 0 if there is none.
+  int writerRate(void) const;
+};
+
+#endif /* _STATUS_POLL_REGISTRY_H_ */
@@ -0,0 +1,171 @@
+/*! \file SubscriberList.h
+ *! \brief Thread-safe list of callbacks with RAII subscription tokens.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+#ifndef _SUBSCRIBER_LIST_H_
+#define _SUBSCRIBER_LIST_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+//! \brief Handle for a callback registered in a SubscriberList. The
+//! callback is removed when the Subscription is destroyed, reset(), or
+//! move-assigned. Movable, not copyable. Outliving the list is harmless.
+class Subscription {
+ public:
+  //! \brief Interface of the list a subscription refers to.
+  struct Source {
+    virtual ~Source() {}
+    virtual void unsubscribe(uint64_t id) =0;
+  };
+
+  Subscription() {}
+  Subscription(std::weak_ptr<Source> _source, uint64_t _id)
+    : source(_source), id(_id) {}
+  Subscription(Subscription&& other)
+    : source(std::move(other.source)), id(other.id) { other.id = 0; }
+  Subscription(const Subscription&) =delete;
+  Subscription& operator=(const Subscription&) =delete;
+
+  Subscription& operator=(Subscription&& other)
+  {
+    if (this != &other) {
+      reset();
+      source = std::move(other.source);
+      id = other.id;
+      other.id = 0;
+    }
+    return *this;
+  }
+
+  ~Subscription() { reset(); }
+
+  //! \brief Remove the callback. When reset() returns, the callback is
+  //! no longer running on another thread, and will not be called anymore.
+  void reset(void)
+  {
+    if (id != 0) {
+      std::shared_ptr<Source> s = source.lock();
+      if (s) s->unsubscribe(id);
+      id = 0;
+    }
+    source.reset();
+  }
+
+  //! \brief Returns whether the subscription is still registered.
+  bool active(void) const { return id != 0 && !source.expired(); }
+
+ protected:
+  std::weak_ptr<Source> source;
+  uint64_t id { 0 };
+};
+
+//! \brief List of callbacks of type Fn, e.g. std::function<void(void)>.
+//!
+//! add() and Subscription::reset() may be called from any thread, also
+//! from within a callback. call() invokes all callbacks, in the order they
+//! were added, without allocating memory: the first N callbacks are stored
+//! inline, further ones in a std::deque, whose elements never move. Slots
+//! of removed callbacks are reused by later add() calls.
+//!
+//! call() holds a recursive lock while the callbacks run. Subscription::
+//! reset() on another thread waits for it, so an object can safely drop
+//! its subscriptions in its destructor.
+template<typename Fn, size_t N =4>
+class SubscriberList {
+ protected:
+  struct Slot {
+    uint64_t id { 0 };  //!< 0 if removed.
+    Fn fn;              //!< Cleared once no call() is running anymore.
+  };
+
+  struct Impl: public Subscription::Source {
+    std::recursive_mutex mtx;
+    Slot inlineSlots[N];
+    std::deque<Slot> overflow;
+    uint64_t nextId { 1 };
+    size_t used { 0 };        //!< Number of registered callbacks.
+    unsigned calling { 0 };   //!< call() nesting depth.
+
+    Slot& slot(size_t i) { return i < N ? inlineSlots[i] : overflow[i-N]; }
+    size_t size(void) const { return N + overflow.size(); }
+
+    void unsubscribe(uint64_t id) override
+    {
+      std::lock_guard<std::recursive_mutex> lock(mtx);
+      for (size_t i=0; i<size(); i++) {
+	Slot& s = slot(i);
+	if (s.id == id) {
+	  s.id = 0;
+	  if (calling == 0)  // else the callback may be running
+	    s.fn = nullptr;
+	  used--;
+	  return;
+	}
+      }
+    }
+  };
+
+  std::shared_ptr<Impl> impl { std::make_shared<Impl>() };
+
+ public:
+  //! \brief Register fn. It stays registered as long as the returned
+  //! Subscription lives. Registering an empty fn does nothing.
+  Subscription add(Fn fn)
+  {
+    if (!fn)
+      return Subscription();
+    std::lock_guard<std::recursive_mutex> lock(impl->mtx);
+    uint64_t id = impl->nextId++;
+    size_t i = 0;
+    while (i < impl->size() && impl->slot(i).fn)
+      i++;
+    if (i == impl->size())
+      impl->overflow.emplace_back();
+    Slot& s = impl->slot(i);
+    s.fn = std::move(fn);
+    s.id = id;
+    impl->used++;
+    return Subscription(std::weak_ptr<Subscription::Source>(impl), id);
+  }
+
+  //! \brief Returns whether no callbacks are registered.
+  bool empty(void) const
+  {
+    std::lock_guard<std::recursive_mutex> lock(impl->mtx);
+    return impl->used == 0;
+  }
+
+  //! \brief Invoke all registered callbacks with args.
+  template<typename... Args>
+  void call(Args... args) const
+  {
+    std::lock_guard<std::recursive_mutex> lock(impl->mtx);
+    if (impl->used == 0)
+      return;
+    // Callbacks added by a callback go to slots not in use by a running
+    // callback, possibly in the overflow deque: re-evaluate size().
+    struct Calling {
+      Impl& impl;
+      Calling(Impl& _impl) : impl(_impl) { impl.calling++; }
+      ~Calling()
+      {
+	if (--impl.calling == 0)
+	  for (size_t i=0; i<impl.size(); i++) {
+	    Slot& s = impl.slot(i);
+	    if (s.id == 0) s.fn = nullptr;
+	  }
+      }
+    } calling(*impl);
+    for (size_t i=0; i<impl->size(); i++) {
+      Slot& s = impl->slot(i);
+      if (s.id != 0)
+	s.fn(args...);
+    }
+  }
+};
+
+#endif /* _SUBSCRIBER_LIST_H_ */
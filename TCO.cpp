@@ -8,22 +8,25 @@
 #include "TCO.h"
 #include "HDSPeCard.h"
 #include "SndControl.h"
+#include "SndTransaction.h"
 
 #include "HDSPeConf.h"
 
 #ifdef DEBUG
-static std::ostream& LtcPrint(std::ostream& s, const std::vector<long long>& ltc, bool df)
+static std::ostream& LtcPrint(std::ostream& s, const HDSPeLtcFrame& frame, bool df)
 {
   static uint64_t prevFrameCount {0};
-  uint64_t frameCount = ltc[1];
-  char buf[100];
-  snprintf(buf, sizeof(buf), "%02llu:%02llu:%02llu%c%02llu @ %ld +%ld",
-	   ((ltc[0] >> 56) & 0x03)*10 + ((ltc[0] >> 48) & 0x0f),
-	   ((ltc[0] >> 40) & 0x07)*10 + ((ltc[0] >> 32) & 0x0f),
-	   ((ltc[0] >> 24) & 0x07)*10 + ((ltc[0] >> 16) & 0x0f),
+  uint64_t frameCount = frame.frameCount;
+  unsigned long long ltc = frame.ltc;
+  char buf[120];
+  snprintf(buf, sizeof(buf), "%02llu:%02llu:%02llu%c%02llu @ %lu +%lu t=%ld.%09ld",
+	   ((ltc >> 56) & 0x03)*10 + ((ltc >> 48) & 0x0f),
+	   ((ltc >> 40) & 0x07)*10 + ((ltc >> 32) & 0x0f),
+	   ((ltc >> 24) & 0x07)*10 + ((ltc >> 16) & 0x0f),
 	   df ? '.' : ':',
-	   ((ltc[0] >>  8) & 0x03)*10 + ((ltc[0] >>  0) & 0x0f),
-	   frameCount, frameCount - prevFrameCount);
+	   ((ltc >>  8) & 0x03)*10 + ((ltc >>  0) & 0x0f),
+	   frameCount, frameCount - prevFrameCount,
+	   (long)frame.time.tv_sec, frame.time.tv_nsec);
   prevFrameCount = frameCount;
   return s << buf;
 }
@@ -41,16 +44,14 @@ MyTCOPanel::MyTCOPanel(class HDSPeTCO* _tco, class wxWindow* parent)
   setPullLabels();
 #endif /*NEVER*/
   
-  // Need to add our own callback to the card panel callbacks for
-  // sampleRate and preferredRef.
-  update_cardPreferredRef = tco->card->preferredRef.callOnValueChange
-    ([this](){PostCB([this](){update_preferredRef();});});
-  update_cardSampleRate = tco->card->sampleRate.callOnValueChange
-    ([this](){PostCB([this](){update_systemSampleRate();});});
-  if (!update_cardPreferredRef || !update_cardSampleRate)
-    throw std::runtime_error("MyTCOPanel: card callbacks not set!\n");
+  // The card panel owns the sampleRate and preferredRef value change
+  // callbacks: subscribe next to it.
+  cardPreferredRefSub = tco->card->preferredRef.subscribeValueChange
+    (refresh.add([this](){update_preferredRef();}));
+  cardSampleRateSub = tco->card->sampleRate.subscribeValueChange
+    (refresh.add([this](){update_systemSampleRate();}));
   
-  SET_CB(ltcIn);
+  ltcFrameSub = tco->subscribeLtcFrame(ltcFrames, POSTCB(update_ltcIn,"ltcIn"));
   SET_CB(ltcInValid);
   SET_CB(ltcInFps);
   SET_CB(ltcInDropFrame);
@@ -71,14 +72,14 @@ MyTCOPanel::MyTCOPanel(class HDSPeTCO* _tco, class wxWindow* parent)
   SET_CB(ltcOut);
   SET_CB(ltcRun);
 
-  ltcSyncButton->Enable(tco->firmware < 11);  // LTC sync is not reliable and no longer available when firmware version is 11 or later.
+  ltcSyncButton->Enable(tco->firmware.load(0) < 11);  // LTC sync is not reliable and no longer available when firmware version is 11 or later.
   videoSyncButton->Enable(true); // always enable: video format is only detected when this button is selected.
   wckSyncButton->Enable(true);   // always enable: word clock speed is only detected when this button is selected.
 }
 
 void MyTCOPanel::setLtcIn(void)
 {
-  unsigned long long ltc = tco->ltcIn;
+  unsigned long long ltc = lastLtcFrame.ltc;
   char buf[20];
   snprintf(buf, sizeof(buf), "%02llu:%02llu:%02llu%c%02llu",
 	   ((ltc >> 56) & 0x03)*10 + ((ltc >> 48) & 0x0f),
@@ -86,7 +87,7 @@ void MyTCOPanel::setLtcIn(void)
 	   ((ltc >> 24) & 0x07)*10 + ((ltc >> 16) & 0x0f),
 	   ':',
 	   ((ltc >>  8) & 0x03)*10 + ((ltc >>  0) & 0x0f));
-  ltcStatusLabel->SetLabel(tco->ltcInValid ? buf : "--:--:--:--");
+  ltcStatusLabel->SetLabel(tco->ltcInValid.load(0) ? buf : "--:--:--:--");
 }
 
 void MyTCOPanel::setLtcInFrameRate(void)
@@ -94,25 +95,30 @@ void MyTCOPanel::setLtcInFrameRate(void)
   const char* fps[4] = { "24", "25", "29.97", "30" };
   const char* df[2] = { "fps", "dfps" };
   char text[25];
-  int pullfac = tco->ltcInPullFac - 1000;
+  int pullfac = tco->ltcInPullFac.load(0) - 1000;
 
   if (pullfac != 0)
     snprintf(text, sizeof(text), "%s %s        %+.1f %%",
-	     fps[tco->ltcInFps], df[tco->ltcInDropFrame],
+	     fps[tco->ltcInFps.load(0)], df[tco->ltcInDropFrame.load(0)],
 	     (double)pullfac * 0.1);
   else
     snprintf(text, sizeof(text), "%s %s", 
-	     fps[tco->ltcInFps], df[tco->ltcInDropFrame]);
+	     fps[tco->ltcInFps.load(0)], df[tco->ltcInDropFrame.load(0)]);
   
-  ltcInFrameRateLabel->SetLabel(tco->ltcInValid ? text : "");
+  ltcInFrameRateLabel->SetLabel(tco->ltcInValid.load(0) ? text : "");
 }
 
 void MyTCOPanel::update_ltcIn(void)
 {
-  setLtcIn();
+  // Drain all frames received since the last update.
+  HDSPeLtcFrame frame;
+  while (ltcFrames.pop(frame)) {
+    lastLtcFrame = frame;
 #ifdef DEBUG  
-  LtcPrint(std::cerr, tco->ltcIn, false) << "\n";
+    LtcPrint(std::cerr, frame, false) << "\n";
 #endif /*DEBUG*/
+  }
+  setLtcIn();
 }
 
 void MyTCOPanel::update_ltcInValid(void)
@@ -139,21 +145,21 @@ void MyTCOPanel::update_ltcInPullFac(void)
 void MyTCOPanel::update_videoFormat(void)
 {
   //  std::cerr << __func__ << ":" << __LINE__ << ": videoFormat=" << tco->videoFormat << "\n";
-  if (tco->firmware < 11)
-    videoStatusLabel->SetLabel(tco->videoFormat==0 ? std::string("") : tco->videoFormat.label());
+  if (tco->firmware.load(0) < 11)
+    videoStatusLabel->SetLabel(tco->videoFormat.load(0)==0 ? std::string("") : tco->videoFormat.label());
 }
 
 void MyTCOPanel::update_videoFps(void)
 {
   //  std::cerr << __func__ << ":" << __LINE__ << ": videoFps=" << tco->videoFps << "\n";
-  if (tco->firmware >= 11)
-    videoStatusLabel->SetLabel(tco->videoFps==0 ? std::string("No Video") :
+  if (tco->firmware.load(0) >= 11)
+    videoStatusLabel->SetLabel(tco->videoFps.load(0)==0 ? std::string("No Video") :
 			       (std::string(tco->videoFps.label()) + " fps"));
 }
 
 void MyTCOPanel::setWckStatus(void)
 {
-  wckStatusLabel->SetLabel(!tco->wckValid ? std::string("") : tco->wckSpeed.label());
+  wckStatusLabel->SetLabel(!tco->wckValid.load(0) ? std::string("") : tco->wckSpeed.label());
 }
 
 void MyTCOPanel::update_wckValid(void)
@@ -168,24 +174,24 @@ void MyTCOPanel::update_wckSpeed(void)
 
 void MyTCOPanel::update_lock(void)
 {
-  lockLabel->SetLabel(tco->lock ? "TCO Lock" : "No TCO Lock");
-  lockLabel->SetBackgroundColour(tco->lock
+  lockLabel->SetLabel(tco->lock.load(0) ? "TCO Lock" : "No TCO Lock");
+  lockLabel->SetBackgroundColour(tco->lock.load(0)
 				 ? wxNullColour : wxColour(0xff, 0xc6, 0x00));
 }
 
 void MyTCOPanel::update_sampleRate(void)
 {
-  ltcSampleRateBox->SetSelection(tco->sampleRate);
+  ltcSampleRateBox->SetSelection(tco->sampleRate.load(0));
 }
 
 void MyTCOPanel::update_pull(void)
 {
-  pullBox->SetSelection(tco->pull);
+  pullBox->SetSelection(tco->pull.load(0));
 }
 
 void MyTCOPanel::update_wckConversion(void)
 {
-  wckConversionBox->SetSelection(tco->wckConversion);
+  wckConversionBox->SetSelection(tco->wckConversion.load(0));
 }
 
 void MyTCOPanel::update_frameRate(void)
@@ -202,25 +208,23 @@ void MyTCOPanel::update_frameRate(void)
 
 void MyTCOPanel::update_syncSrc(void)
 {
-  wckSyncButton->SetValue(tco->syncSrc == 0);
-  videoSyncButton->SetValue(tco->syncSrc == 1);
-  ltcSyncButton->SetValue(tco->syncSrc == 2);
+  wckSyncButton->SetValue(tco->syncSrc.load(0) == 0);
+  videoSyncButton->SetValue(tco->syncSrc.load(0) == 1);
+  ltcSyncButton->SetValue(tco->syncSrc.load(0) == 2);
 }
 
 void MyTCOPanel::update_wordTerm(void)
 {
-  termButton->SetValue(tco->wordTerm);
+  termButton->SetValue(tco->wordTerm.load(0));
 }
 
 void MyTCOPanel::update_preferredRef(void)
 {
-  update_cardPreferredRef();
   setCardStatus();
 }
 
 void MyTCOPanel::update_systemSampleRate(void)
 {
-  update_cardSampleRate();
   setCardStatus();
 }
 
@@ -230,7 +234,7 @@ void MyTCOPanel::update_ltcOut(void)
 
 void MyTCOPanel::update_ltcRun(void)
 {
-  ltcRunButton->SetValue(tco->ltcRun);
+  ltcRunButton->SetValue(tco->ltcRun.load(0));
 }
 
 void MyTCOPanel::setCardStatus(void)
@@ -238,10 +242,10 @@ void MyTCOPanel::setCardStatus(void)
   useTCOButton->SetValue(tco->card->isSyncedToTco());
 
   char buf[20];
-  double sampleRate = tco->card->getSystemSampleRate();
-  snprintf(buf, sizeof(buf), "%.1f", sampleRate);
+  SampleRate sampleRate = tco->card->getSystemRate();
+  snprintf(buf, sizeof(buf), "%.1f", sampleRate.toDouble());
   sampleRateLabel->SetLabelText(buf);
-  sampleRateLabel->SetBackgroundColour(tco->card->isStandardSampleRate(sampleRate)
+  sampleRateLabel->SetBackgroundColour(sampleRate.isStandard()
 				       ? wxNullColour : wxColour(0xff, 0xc6, 0x00));
 }
 
@@ -343,27 +347,29 @@ void MyTCOPanel::useTcoCB(wxCommandEvent &event)
 
 void MyTCOPanel::autoCB(wxCommandEvent &event)
 {
-  if (!tco->ltcInValid) {
+  if (!tco->ltcInValid.load(0)) {
     std::cerr << "No valid LTC input to jam sync with!\n";
     return;
   }
 
-  int fps = tco->ltcInFps;
-  int df = tco->ltcInDropFrame;
+  int fps = tco->ltcInFps.load(0);
+  int df = tco->ltcInDropFrame.load(0);
   if (df)
     fps = 2;      // 29.97 fps
 
   int pull = 0;
-  if (tco->ltcInPullFac == 999) {
+  if (tco->ltcInPullFac.load(0) == 999) {
     if (fps == 3)
       fps = 2;    // 30 - 0.1% = 29.97
     else if (fps != 2)
       pull = 1;   // -0.1%
   }
   
-  tco->setFrameRate(fps, df);
-  tco->pull.set(pull);
-  tco->sampleRate.set(2);   // "From App"
+  SndTransaction t;
+  t.set(tco->frameRate, HDSPeTCO::frameRateItem(fps, df));
+  t.set(tco->pull, pull);
+  t.set(tco->sampleRate, 2);   // "From App"
+  t.commit();
 }
 
 void MyTCOPanel::ltcRunCB(wxCommandEvent &event)
@@ -395,12 +401,12 @@ void MyTCOPanel::wallClockCB(wxCommandEvent &event)
 
 void MyTCOPanel::jamSyncCB(wxCommandEvent &event)
 {
-  if (!tco->ltcInValid) {
+  if (!tco->ltcInValid.load(0)) {
     std::cerr << "No valid LTC input to jam sync with!\n";
     return;
   }
 
-  const std::vector<long long> ltc = tco->ltcIn;
+  const std::vector<long long> ltc = tco->ltcIn.load();
   tco->ltcOut.set(ltc);
 }
 
@@ -7,6 +7,8 @@
 
 #include "TCOPanel.h"
 #include "SndControl.h"
+#include "HDSPeConf.h"
+#include "HDSPeCard.h"
 
 class MyTCOPanel: public TCOPanel {
  public:
@@ -14,6 +16,9 @@ class MyTCOPanel: public TCOPanel {
   
  protected:
   class HDSPeTCO* tco { nullptr };
+  RefreshBatcher refresh;   //!< Coalesces control value change updates.
+  HDSPeTCO::LtcFrameRing ltcFrames; //!< LTC input frames queued for this panel.
+  HDSPeLtcFrame lastLtcFrame; //!< Latest LTC input frame taken from ltcFrames.
 
   void update_ltcIn(void);
   void update_ltcInValid(void);
@@ -62,8 +67,11 @@ class MyTCOPanel: public TCOPanel {
   void update_preferredRef(void);
   void update_systemSampleRate(void);
   void setCardStatus(void);
-  SndControl::Callback update_cardSampleRate { nullptr };
-  SndControl::Callback update_cardPreferredRef { nullptr };
+
+  // Declared after refresh and ltcFrames: unsubscribed before they go away.
+  Subscription cardPreferredRefSub; //!< Card preferredRef value changes.
+  Subscription cardSampleRateSub;   //!< Card sampleRate value changes.
+  Subscription ltcFrameSub;         //!< LTC input frames.
 };
 
 #endif /* _TCO_H_ */
@@ -0,0 +1,403 @@
+/*! \file bench.cpp
+ *! \brief Benchmarks of the SndCard/SndControl hot paths: control element
+ *! read and write, enumerated labels, ASCII ids and value change event
+ *! dispatch.
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+// Usage: bench [-n <iterations>] [--write] [--event <element>] [<card>]
+//
+// Without <card> argument, or with <card> "sim", a built-in simulated card
+// is used (see SndSimCard.h). Otherwise <card> is an ALSA card name like
+// "hw:0". On real cards, the first readable element of each value type is
+// benchmarked. Element values are written only with --write, and then only
+// with the values they already have. Event latency is measured on a real
+// card only if an INTEGER or BOOLEAN element to toggle is named with
+// --event. The original value is restored afterwards.
+//
+// The value conversion of SndAnyControl::read() and write() is compared
+// with the former std::function based implementation on a many-channel
+// enumerated element: "Bench Sync Status" on the simulated card, "AutoSync
+// Frequency" on a real card.
+//
+// Each benchmark reports the number of samples and the minimum, median,
+// 90th, 99th percentile and maximum time per operation, in microseconds.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SndCard.h"
+#include "SndControl.h"
+#include "SndSimCard.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed(Clock::time_point t0, Clock::time_point t1)
+{
+  return std::chrono::duration<double, std::micro>(t1 - t0).count();
+}
+
+//! \brief Print percentiles of the samples, in microseconds.
+static void report(const std::string& what, std::vector<double> t)
+{
+  if (t.empty())
+    return;
+  std::sort(t.begin(), t.end());
+  auto pct = [&t](double p) { return t[(size_t)(p * (t.size()-1))]; };
+  printf("%-44s %7zu %9.2f %9.2f %9.2f %9.2f %9.2f\n", what.c_str(),
+	 t.size(), t.front(), pct(0.5), pct(0.9), pct(0.99), t.back());
+}
+
+//! \brief Time n invocations of op.
+template<typename Op>
+static std::vector<double> measure(int n, Op op)
+{
+  std::vector<double> t;
+  t.reserve(n);
+  for (int i=0; i<n; i++) {
+    Clock::time_point t0 = Clock::now();
+    op();
+    t.push_back(elapsed(t0, Clock::now()));
+  }
+  return t;
+}
+
+//! \brief Same, timing batches of batch invocations, and reporting the
+//! time per invocation.
+template<typename Op>
+static std::vector<double> measure(int n, int batch, Op op)
+{
+  std::vector<double> t;
+  t.reserve(n);
+  for (int i=0; i<n; i++) {
+    Clock::time_point t0 = Clock::now();
+    for (int j=0; j<batch; j++)
+      op();
+    t.push_back(elapsed(t0, Clock::now()) / batch);
+  }
+  return t;
+}
+
+static const char* typeName(snd_ctl_elem_type_t type)
+{
+  switch (type) {
+  case SND_CTL_ELEM_TYPE_BOOLEAN:    return "bool";
+  case SND_CTL_ELEM_TYPE_INTEGER:    return "int";
+  case SND_CTL_ELEM_TYPE_INTEGER64:  return "int64";
+  case SND_CTL_ELEM_TYPE_ENUMERATED: return "enum";
+  case SND_CTL_ELEM_TYPE_BYTES:      return "bytes";
+  case SND_CTL_ELEM_TYPE_IEC958:     return "iec958";
+  default:                           return "other";
+  }
+}
+
+//! \brief Benchmark read(), write() if requested, getAsciiId() and, for
+//! enumerated controls, label().
+static void benchControl(SndControl* c, int n, bool write)
+{
+  const std::string what = std::string(typeName(c->getType()))
+    + " '" + c->getName() + "'";
+
+  report(what + " read", measure(n, [c]() { c->read(); }));
+  if (write && c->isWritable())
+    report(what + " write", measure(n, [c]() { c->write(); }));
+  report(what + " getAsciiId", measure(n, [c]() { c->getAsciiId(); }));
+
+  SndEnumControl* e = dynamic_cast<SndEnumControl*>(c);
+  if (e) {
+    unsigned items = e->getEnumCount();
+    unsigned i = 0;
+    report(what + " label",
+	   measure(n, [e, items, &i]() { e->getEnumLabel(i++ % items); }));
+  }
+}
+
+//! \brief SndEnumControl with the former std::function based value
+//! conversion in read() and write(), for comparison with the template
+//! based conversion of SndAnyControl.
+class LegacyEnumControl: public SndEnumControl {
+public:
+  using Getter = std::function<unsigned(snd_ctl_elem_value_t* ctl, unsigned channel)>;
+  using Setter = std::function<void(snd_ctl_elem_value_t* ctl, unsigned channel,
+				    unsigned value)>;
+  using Valid = std::function<bool(unsigned value)>;
+
+  using SndEnumControl::SndEnumControl;
+
+  //! \brief Former conversion loop of SndAnyControl::read().
+  void getLegacy(snd_ctl_elem_value_t* ctl, Getter getter)
+  {
+    val.resize(count);
+    for (unsigned i=0; i<count; i++)
+      val[i] = getter(ctl, i);
+  }
+
+  //! \brief Former conversion loop of SndAnyControl::write().
+  void setLegacy(snd_ctl_elem_value_t* ctl, Setter setter, Valid valid)
+  {
+    for (unsigned i=0; i<count; i++) {
+      if (!valid(val[i]))
+	throw std::runtime_error("value out of range");
+      setter(ctl, i, val[i]);
+    }
+  }
+
+  void getLegacy(snd_ctl_elem_value_t* ctl)
+  {
+    getLegacy(ctl, snd_ctl_elem_value_get_enumerated);
+  }
+
+  void setLegacy(snd_ctl_elem_value_t* ctl)
+  {
+    unsigned n = getEnumCount();
+    setLegacy(ctl, snd_ctl_elem_value_set_enumerated,
+	      [n] (unsigned value) { return value<n; });
+  }
+
+  //! \brief Current conversion loops, as in SndEnumControl::read() and
+  //! write().
+  void getTemplate(snd_ctl_elem_value_t* ctl)
+  {
+    getValues(ctl, [](snd_ctl_elem_value_t* ctl, unsigned idx) {
+	return snd_ctl_elem_value_get_enumerated(ctl, idx);
+      });
+  }
+
+  void setTemplate(snd_ctl_elem_value_t* ctl)
+  {
+    unsigned n = getEnumCount();
+    setValues(ctl, [](snd_ctl_elem_value_t* ctl, unsigned idx, unsigned v) {
+	snd_ctl_elem_value_set_enumerated(ctl, idx, v);
+      },
+      [n] (unsigned value) { return value<n; });
+  }
+
+  //! \brief Former read() and write(), driver access included.
+  void readLegacy(void)
+  {
+    snd_ctl_elem_value_t *ctl;
+    snd_ctl_elem_value_alloca(&ctl);
+    SndCheckErr(snd_hctl_elem_read(elem, ctl), "hctl_elem_read");
+    CacheLocker g(this);
+    getLegacy(ctl);
+    publish();
+  }
+
+  void writeLegacy(void)
+  {
+    snd_ctl_elem_value_t *ctl;
+    snd_ctl_elem_value_alloca(&ctl);
+    { CacheLocker g(this);
+      setLegacy(ctl); }
+    SndCheckErr(snd_hctl_elem_write(elem, ctl), "hctl_elem_write");
+    CacheLocker g(this);
+    publish();
+  }
+};
+
+//! \brief Compare std::function and template based value conversion on
+//! a many-channel enumerated control.
+static void benchConversion(LegacyEnumControl& c, int n, bool write)
+{
+  const std::string what = "enum[" + std::to_string(c.getCount()) + "] '"
+    + c.getName() + "'";
+
+  snd_ctl_elem_value_t *ctl;
+  snd_ctl_elem_value_alloca(&ctl);
+  {
+    SndControl::CacheLocker g(c);
+    const int batch = 100;
+    report(what + " get std::function", measure(n, batch, [&]() { c.getLegacy(ctl); }));
+    report(what + " get template", measure(n, batch, [&]() { c.getTemplate(ctl); }));
+    report(what + " set std::function", measure(n, batch, [&]() { c.setLegacy(ctl); }));
+    report(what + " set template", measure(n, batch, [&]() { c.setTemplate(ctl); }));
+  }
+
+  report(what + " read std::function", measure(n, [&]() { c.readLegacy(); }));
+  report(what + " read template", measure(n, [&]() { c.read(); }));
+  if (write && c.isWritable()) {
+    report(what + " write std::function", measure(n, [&]() { c.writeLegacy(); }));
+    report(what + " write template", measure(n, [&]() { c.write(); }));
+  }
+}
+
+//! \brief Measures the time from a value change to the value change
+//! callback, invoked on the control event handling thread. change(i)
+//! performs the i-th change and returns its time stamp.
+static std::vector<double> eventLatency(SndControl* c, int n,
+					std::function<Clock::time_point(int)> change)
+{
+  std::mutex mtx;
+  std::condition_variable cond;
+  bool seen = false;
+  Clock::time_point received;
+
+  auto prev = c->callOnValueChange([&]() {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx);
+    received = now;
+    seen = true;
+    cond.notify_one();
+  });
+
+  std::vector<double> t;
+  t.reserve(n);
+  for (int i=0; i<n; i++) {
+    { std::lock_guard<std::mutex> lock(mtx); seen = false; }
+    Clock::time_point sent = change(i);
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!cond.wait_for(lock, std::chrono::seconds(1), [&seen]() { return seen; })) {
+      std::cerr << "bench: no value change event for '" << c->getName()
+		<< "' within 1 second.\n";
+      break;
+    }
+    t.push_back(elapsed(sent, received));
+  }
+
+  c->callOnValueChange(prev);
+  return t;
+}
+
+//! \brief Create the simulated card elements used for benchmarking.
+static void makeSimCard(SndSimCard& sim)
+{
+  sim.addBool  ("Bench Boolean", 1);
+  sim.addInt   ("Bench Integer", 2, 0, 1000);
+  sim.addInt64 ("Bench Integer64", 2, 0, 1LL << 62);
+  sim.addEnum  ("Bench Enumerated", 1,
+		{ "32 KHz", "44.1 KHz", "48 KHz", "64 KHz", "88.2 KHz",
+		  "96 KHz", "128 KHz", "176.4 KHz", "192 KHz" });
+  sim.addBytes ("Bench Bytes", 64);
+  sim.addIec958("Bench IEC958");
+  sim.addInt   ("Bench Event", 1, 0, 1000000, 0, SndSimCard::READ);
+  sim.addEnum  ("Bench Sync Status", 11, { "No Lock", "Lock", "Sync", "N/A" });
+}
+
+static void usage(const char* argv0)
+{
+  std::cerr << "Usage: " << argv0
+	    << " [-n <iterations>] [--write] [--event <element>] [<card>]\n";
+}
+
+int main(int argc, char** argv)
+{
+  int n = 10000;
+  bool write = false;
+  std::string cardName = "sim";
+  std::string eventName;
+  for (int i=1; i<argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg == "-n" && i+1 < argc)
+      n = atoi(argv[++i]);
+    else if (arg == "--write")
+      write = true;
+    else if (arg == "--event" && i+1 < argc)
+      eventName = argv[++i];
+    else if (arg[0] == '-') {
+      usage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 1;
+    } else
+      cardName = arg;
+  }
+  if (n < 1) n = 1;
+
+  std::unique_ptr<SndSimCard> sim;
+  if (cardName == "sim") {
+    cardName = "sim:bench";
+    sim.reset(new SndSimCard(cardName));
+    makeSimCard(*sim);
+    write = true;
+    eventName = "Bench Event";
+  }
+
+  try {
+    SndCard card(cardName);
+    std::cout << "Card " << cardName << " : " << card.getLongName() << "\n";
+    printf("%-44s %7s %9s %9s %9s %9s %9s\n", "benchmark (microseconds)",
+	   "samples", "min", "median", "90%", "99%", "max");
+
+    std::vector<SndControl*> controls = card.getControls();
+
+    // First readable control of each type.
+    static const snd_ctl_elem_type_t types[] = {
+      SND_CTL_ELEM_TYPE_BOOLEAN, SND_CTL_ELEM_TYPE_INTEGER,
+      SND_CTL_ELEM_TYPE_INTEGER64, SND_CTL_ELEM_TYPE_ENUMERATED,
+      SND_CTL_ELEM_TYPE_BYTES, SND_CTL_ELEM_TYPE_IEC958
+    };
+    for (auto type: types) {
+      for (auto c: controls) {
+	if (c->getType() == type && c->isReadable()) {
+	  benchControl(c, n, write);
+	  break;
+	}
+      }
+    }
+
+    // Many-channel value conversion.
+    const std::string convName = sim ? "Bench Sync Status" : "AutoSync Frequency";
+    for (auto c: controls) {
+      if (c->getName() == convName && c->getType() == SND_CTL_ELEM_TYPE_ENUMERATED
+	  && c->isReadable()) {
+	// card wraps every element already, c included: use a handle of
+	// its own, so each element has a single SndControl.
+	SndCard convCard(cardName);
+	LegacyEnumControl conv(&convCard, convName);
+	benchConversion(conv, n, write);
+	break;
+      }
+    }
+
+    SndControl* ev { nullptr };
+    for (auto c: controls)
+      if (!eventName.empty() && c->getName() == eventName)
+	ev = c;
+
+    int nev = std::min(n, 1000);
+    if (ev && sim) {
+      // Driver side value change to callback.
+      report("event '" + eventName + "' sim change -> callback",
+	     eventLatency(ev, nev, [&sim](int i) {
+		 Clock::time_point t = Clock::now();
+		 sim->set("Bench Event", { i+1 });
+		 return t;
+	       }));
+    } else if (ev && ev->isWritable() &&
+	       (ev->getType() == SND_CTL_ELEM_TYPE_INTEGER ||
+		ev->getType() == SND_CTL_ELEM_TYPE_BOOLEAN)) {
+      // Client write to callback, toggling the value.
+      SndIntControl* ic = dynamic_cast<SndIntControl*>(ev);
+      SndBoolControl* bc = dynamic_cast<SndBoolControl*>(ev);
+      ev->read();
+      long orig = ic ? ic->value() : bc->value();
+      long alt = ic ? (orig > 0 ? orig-1 : orig+1) : !orig;
+      report("event '" + eventName + "' write -> callback",
+	     eventLatency(ev, nev, [&](int i) {
+		 Clock::time_point t = Clock::now();
+		 if (ic) ic->set(i%2 ? orig : alt); else bc->set(i%2 ? orig : alt);
+		 return t;
+	       }));
+      if (ic) ic->set(orig); else bc->set(orig);
+    } else if (!eventName.empty()) {
+      std::cerr << "bench: no writable INTEGER or BOOLEAN element '"
+		<< eventName << "'.\n";
+    }
+
+    for (auto c: controls)
+      delete c;
+  } catch (std::runtime_error& e) {
+    std::cerr << "bench: " << e.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
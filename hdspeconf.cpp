@@ -12,6 +12,10 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <sys/types.h>
 
@@ -21,6 +25,11 @@
 
 #include "HDSPeConf.h"
 #include "HDSPeCard.h"
+#include "HDSPeDaemon.h"
+#include "HDSPeSimCard.h"
+
+//! \brief Start of the program, for reporting the time to first window.
+static std::chrono::steady_clock::time_point startTime;
 
 //! \brief Main window: a notebook containing pages for each HDSPe card
 //! and TCO.
@@ -28,31 +37,35 @@ class MainWindow: public wxFrame {
 public:
   HDSPeCardEnumerator cardEnumerator;  // enumerates HDSPe cards on construction
 
-    MainWindow()    
+  MainWindow(const std::vector<std::string>& extraCards)
     : wxFrame(nullptr, wxID_ANY, wxEmptyString,
 	      wxDefaultPosition, wxDefaultSize, wxDEFAULT_FRAME_STYLE)
+    , cardEnumerator(extraCards)
   {
     SetTitle(wxT("hdspeconf"));
     wxPanel* panel_1 = new wxPanel(this, wxID_ANY);
     wxBoxSizer* sizer_1 = new wxBoxSizer(wxVERTICAL);
     notebook_1 = new wxChoicebook(panel_1, wxID_ANY);
     sizer_1->Add(notebook_1, 1, wxEXPAND, 0);
+    notebook_1->Bind(wxEVT_CHOICEBOOK_PAGE_CHANGED, &MainWindow::onPageChanged, this);
 
-    // Add a notebook page for each hdspe card + TCO expansion module.
-    std::vector<HDSPeCard*>& cards = cardEnumerator.getCards();
-    if (cards.size() == 0) {
-      // Add page with message if no hdspe driven cards are available
-      notebook_1->AddPage(new NoCardsPanel(notebook_1, wxID_ANY), wxT(""));
-    } else {
-      for (auto card: cards) {
-	wxPanel *panel = card->makePanel(notebook_1);
-	notebook_1->AddPage(panel, card->getPrettyName());
-
-	if (card->hasTco())
-	  notebook_1->AddPage(card->makeTcoPanel(notebook_1),
-			      std::string(card->getPrettyName()) + " TCO");
-      }
-    }
+    // Add a notebook page for each hdspe card + TCO expansion module,
+    // right away for the cards present, and later on for cards that are
+    // plugged in. Cards come and go on the hotplug thread: pass them on
+    // to the GUI thread.
+    guiThread = std::this_thread::get_id();
+    std::shared_ptr<MainWindow*> self = alive;
+    cardsSub = cardEnumerator.subscribeCards
+      ([this, self](std::shared_ptr<HDSPeCard> card, bool added) {
+	if (std::this_thread::get_id() == guiThread)
+	  onCard(card, added);
+	else
+	  PostCB([self, card, added]() {
+	      if (*self) (*self)->onCard(card, added);
+	    });
+      });
+    if (pages.empty())
+      showNoCards(true);
     // TODO: add "About" panel.
     
     panel_1->SetSizer(sizer_1);
@@ -69,12 +82,114 @@ public:
 
   ~MainWindow()
   {
+    *alive = nullptr;
   }
 
 protected:
   wxChoicebook *notebook_1 { nullptr };
+  wxWindow* noCardsPage { nullptr };     //!< Message page shown if there are no cards.
+
+  //! \brief Notebook pages of each card: the card panel and the TCO panel.
+  //! Holding the card keeps it alive as long as its panels exist.
+  std::vector<std::pair<std::shared_ptr<HDSPeCard>, wxWindow*>> pages;
+
+  //! \brief TCO pages not shown yet. Their TCO panel, and with it the TCO
+  //! controls, are only made when the page is first selected.
+  std::set<wxWindow*> unloadedTcoPages;
+
+  std::thread::id guiThread;             //!< Thread that constructed us.
+  std::shared_ptr<MainWindow*> alive { std::make_shared<MainWindow*>(this) }; //!< nullptr once destroyed.
+  Subscription cardsSub;                 //!< Card list changes.
+
+  //! \brief Delete notebook page showing window w.
+  void deletePage(wxWindow* w)
+  {
+    for (size_t i=0; i<notebook_1->GetPageCount(); i++)
+      if (notebook_1->GetPage(i) == w) {
+	notebook_1->DeletePage(i);
+	return;
+      }
+  }
+
+  //! \brief Show or hide the page with message that no cards are available.
+  void showNoCards(bool show)
+  {
+    if (show && !noCardsPage) {
+      noCardsPage = new NoCardsPanel(notebook_1, wxID_ANY);
+      notebook_1->AddPage(noCardsPage, wxT(""));
+    } else if (!show && noCardsPage) {
+      deletePage(noCardsPage);
+      noCardsPage = nullptr;
+    }
+  }
+
+  //! \brief Add or remove the pages of card. GUI thread only.
+  void onCard(std::shared_ptr<HDSPeCard> card, bool added)
+  {
+    if (added) {
+      for (auto& p: pages)
+	if (p.first == card)
+	  return;
+      showNoCards(false);
+
+      wxPanel *panel = card->makePanel(notebook_1);
+      notebook_1->AddPage(panel, card->getPrettyName());
+      pages.emplace_back(card, panel);
+
+      if (card->hasTco()) {
+	wxPanel *tcoPage = new wxPanel(notebook_1, wxID_ANY);
+	notebook_1->AddPage(tcoPage, std::string(card->getPrettyName()) + " TCO");
+	pages.emplace_back(card, tcoPage);
+	unloadedTcoPages.insert(tcoPage);
+      }
+    } else {
+      for (auto it = pages.begin(); it != pages.end(); ) {
+	if (it->first == card) {
+	  unloadedTcoPages.erase(it->second);
+	  deletePage(it->second);
+	  it = pages.erase(it);
+	} else
+	  it++;
+      }
+      if (pages.empty())
+	showNoCards(true);
+    }
+    // Deleting pages may have selected another one.
+    loadPage(notebook_1->GetCurrentPage());
+    Layout();
+  }
+
+  //! \brief Make the TCO panel of page, if it is a TCO page not shown
+  //! before.
+  void loadPage(wxWindow* page)
+  {
+    if (!page || unloadedTcoPages.erase(page) == 0)
+      return;
+    for (auto& p: pages) {
+      if (p.second != page)
+	continue;
+      wxPanel* tcoPanel = p.first->makeTcoPanel(page);
+      if (tcoPanel) {
+	wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(tcoPanel, 1, wxEXPAND, 0);
+	page->SetSizer(sizer);
+	page->Layout();
+      }
+      return;
+    }
+  }
+
+  void onPageChanged(wxBookCtrlEvent& event)
+  {
+    event.Skip();
+    if (event.GetSelection() != wxNOT_FOUND)
+      loadPage(notebook_1->GetPage(event.GetSelection()));
+  }
 };
 
+//! \brief Names of extra (simulated) cards to show, set by main().
+static std::vector<std::string> extraCards;
+
 //! \brief The application.
 class HDSPeConf: public wxApp {
 public:
@@ -83,10 +198,14 @@ public:
     wxInitAllImageHandlers();
     
     try {
-      mainWindow = new MainWindow;      
+      mainWindow = new MainWindow(extraCards);
       SetTopWindow(mainWindow);
 
       mainWindow->Show();
+      std::cout << "Main window shown "
+		<< std::chrono::duration<double, std::milli>
+		   (std::chrono::steady_clock::now() - startTime).count()
+		<< " ms after start.\n";
     } catch (std::exception &e) {
       std::cerr << "OnInit C++ exception caught: " << e.what() << "\n";
       return false;
@@ -135,11 +254,82 @@ protected:
   MainWindow* mainWindow {nullptr};
 };
 
-IMPLEMENT_APP(HDSPeConf)
+IMPLEMENT_APP_NO_MAIN(HDSPeConf)
 
 void PostCB(std::function<void(void)> cb)
 {
-  ::wxGetApp().post(cb);
+  if (wxTheApp)
+    ::wxGetApp().post(cb);
+  else
+    cb();     // daemon mode: no main loop to post to.
+}
+
+static void usage(const char* argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [--simulate] [--daemon [--socket <path>]]\n"
+	    << "  --simulate       : add a simulated AES card with TCO, for testing without hardware.\n"
+	    << "  --daemon         : run without GUI, serving card status on a UNIX socket.\n"
+	    << "  --socket <path>  : daemon socket file name (default "
+	    << HDSPeDaemon::defaultSocketPath() << ").\n"
+	    << "Without --daemon, other options are passed on to wxWidgets and GTK,\n"
+	    << "e.g. --display=:1.\n";
+}
+
+int main(int argc, char** argv)
+{
+  startTime = std::chrono::steady_clock::now();
+  bool daemon = false;
+  bool simulate = false;
+  std::string socketPath = HDSPeDaemon::defaultSocketPath();
+  // Arguments not recognised here go to wxWidgets, e.g. GTK and X options
+  // like --display, in GUI mode. The daemon rejects them.
+  std::vector<char*> wxArgs { argv[0] };
+  for (int i=1; i<argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg == "--daemon")
+      daemon = true;
+    else if (arg == "--simulate")
+      simulate = true;
+    else if (arg == "--socket" && i+1 < argc)
+      socketPath = argv[++i];
+    else if (arg == "--help" || arg == "-h") {
+      usage(argv[0]);
+      return 0;
+    } else
+      wxArgs.push_back(argv[i]);
+  }
+  if (daemon && wxArgs.size() > 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // The simulated card starts threads of its own: they must not receive
+  // the signals the daemon handles.
+  if (daemon)
+    HDSPeDaemon::blockSignals();
+
+  // The simulated card must outlive the card objects using it.
+  std::unique_ptr<HDSPeSimCard> sim;
+  if (simulate) {
+    sim.reset(new HDSPeSimCard("sim:0", true));
+    sim->simulateSyncChanges(0.5);
+    sim->simulateLtc(25);
+    extraCards.push_back(sim->getName());
+  }
+
+  if (!daemon) {
+    int wxArgc = wxArgs.size();
+    wxArgs.push_back(nullptr);
+    return wxEntry(wxArgc, wxArgs.data());
+  }
+
+  try {
+    HDSPeDaemon d(socketPath, extraCards);
+    return d.run();
+  } catch (std::exception& e) {
+    std::cerr << "hdspeconf: " << e.what() << "\n";
+    return 1;
+  }
 }
 
 #ifdef NEVER
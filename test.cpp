@@ -0,0 +1,518 @@
+/*! \file test.cpp
+ *! \brief Unit tests of the helper classes. Tests that need a sound card
+ *! use a simulated card (see SndSimCard.h).
+ * Philippe.Bekaert@uhasselt.be - 20261016 */
+
+// Usage: test [<test>...]
+//
+// Runs the named tests, or all tests without arguments. Each failing check
+// is reported with its file and line. The exit status is 1 if any check
+// failed.
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <math.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "RingBuffer.h"
+#include "SampleRate.h"
+#include "SndCard.h"
+#include "SndCoalescingWriter.h"
+#include "SndControl.h"
+#include "SndSimCard.h"
+#include "SndTransaction.h"
+#include "StatusPollRegistry.h"
+#include "SubscriberList.h"
+
+static int checks { 0 }, failures { 0 };
+
+static void check(bool ok, const char* what, const char* file, int line)
+{
+  checks++;
+  if (ok)
+    return;
+  failures++;
+  printf("%s:%d: check failed: %s\n", file, line, what);
+}
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+//! \brief Wait at most a second for cond() to become true.
+template<typename Cond>
+static bool waitFor(Cond cond)
+{
+  for (int i=0; i<1000 && !cond(); i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return cond();
+}
+
+//! \brief SampleRate: exact 128-bit rational arithmetic.
+static void testSampleRate(void)
+{
+  // Normalization.
+  CHECK(!SampleRate().valid());
+  CHECK(!SampleRate(48000, 0).valid());
+  CHECK(!SampleRate(48000, -1).valid());
+  CHECK(SampleRate(-48000, -1) == SampleRate(48000));
+  CHECK(SampleRate(96000, 2) == SampleRate(48000));
+  CHECK(SampleRate(95999, 2).round() == 48000);
+  CHECK(SampleRate(95997, 2).round() == 47999);
+
+  // Raw Sample Rate-like values: the cross products overflow 64 bits.
+  const long long num = 110069313433624LL, den = 2293110696LL;
+  SampleRate a(num, den), b(num, den + 1);
+  CHECK(a > b && b < a && a != b);
+  CHECK(a.round() == 48000);
+  CHECK(fabs(a.pitch(b) - 1. / den) < 1e-6 / den);
+  CHECK(a.pitch(a) == 0.);
+
+  // Rates that differ by less than double precision.
+  const long long big = 4611686018427387902LL;
+  SampleRate c(big + 1, big), d(big, big - 1);
+  CHECK(c.toDouble() == d.toDouble());
+  CHECK(c < d && c != d);
+
+  // The 100 PPM limit is exact and inclusive.
+  CHECK(SampleRate(480048000, 10000).deviates(SampleRate(48000)));
+  CHECK(!SampleRate(480047999, 10000).deviates(SampleRate(48000)));
+  CHECK(SampleRate(479952000, 10000).deviates(SampleRate(48000)));
+  CHECK(!SampleRate(479952001, 10000).deviates(SampleRate(48000)));
+  CHECK(!SampleRate().deviates(SampleRate(48000)));
+  CHECK(!SampleRate(48000).deviates(SampleRate()));
+  CHECK(SampleRate(48000).pitch(SampleRate()) == 0.);
+
+  // Speed modes and standard rates.
+  CHECK(SampleRate(192000).singleSpeed() == SampleRate(48000));
+  CHECK(SampleRate(88200).singleSpeed() == SampleRate(44100));
+  CHECK(SampleRate(55999).singleSpeed() == SampleRate(55999));
+  CHECK(SampleRate(88210).nearestStandard() == SampleRate(88200));
+  CHECK(SampleRate(127000).nearestStandard() == SampleRate(128000));
+  CHECK(SampleRate(48004).isStandard());
+  CHECK(!SampleRate(48005).isStandard());
+  CHECK(a.isStandard());
+}
+
+//! \brief RingBuffer: order, overflow, and a producer and consumer thread.
+static void testRingBuffer(void)
+{
+  RingBuffer<int, 4> r;
+  int v = -1;
+  CHECK(r.empty() && !r.pop(v) && v == -1);
+
+  // Wraps around several times; a full ring drops and counts new items.
+  int next = 0, expect = 0;
+  for (int round=0; round<3; round++) {
+    for (int i=0; i<4; i++)
+      CHECK(r.push(next++));
+    CHECK(!r.push(-1));
+    CHECK(r.size() == 4);
+    for (int i=0; i<4; i++)
+      CHECK(r.pop(v) && v == expect++);
+    CHECK(r.empty());
+  }
+  CHECK(r.getDropped() == 3);
+
+  r.push(1); r.push(2);
+  r.clear();
+  CHECK(r.empty() && !r.pop(v));
+
+  // Items arrive in order, none lost as long as the ring has room.
+  static const int n = 100000;
+  RingBuffer<int, 64> ring;
+  std::thread producer([&ring] () {
+      for (int i=0; i<n; i++)
+	while (!ring.push(i))
+	  std::this_thread::yield();
+    });
+  bool ordered = true;
+  for (int i=0; i<n; i++) {
+    int item;
+    while (!ring.pop(item))
+      std::this_thread::yield();
+    ordered = ordered && item == i;
+  }
+  producer.join();
+  CHECK(ordered);
+  CHECK(ring.empty());
+}
+
+//! \brief SubscriberList: call order, removal, overflow, changes from
+//! within callbacks, and subscriptions outliving the list.
+static void testSubscriberList(void)
+{
+  std::vector<int> calls;
+  std::unique_ptr<SubscriberList<std::function<void(int)>, 2>> list
+    (new SubscriberList<std::function<void(int)>, 2>);
+  CHECK(list->empty());
+  CHECK(!list->add(nullptr).active());
+
+  // Beyond the inline slots, in order.
+  std::vector<Subscription> subs;
+  for (int i=0; i<5; i++)
+    subs.push_back(list->add([&calls, i] (int arg) { calls.push_back(10*arg + i); }));
+  list->call(1);
+  CHECK(calls == std::vector<int>({10, 11, 12, 13, 14}));
+
+  // Removal; freed slots are reused.
+  subs[1].reset();
+  subs[3] = Subscription();
+  CHECK(!subs[1].active() && !subs[3].active());
+  calls.clear();
+  list->call(2);
+  CHECK(calls == std::vector<int>({20, 22, 24}));
+  subs[1] = list->add([&calls] (int arg) { calls.push_back(-arg); });
+  calls.clear();
+  list->call(3);
+  CHECK(calls == std::vector<int>({30, -3, 32, 34}));
+
+  // A callback removing itself and adding another one.
+  Subscription self, added;
+  self = list->add([&] (int arg) {
+      self.reset();
+      added = list->add([&calls] (int arg) { calls.push_back(100 + arg); });
+    });
+  calls.clear();
+  list->call(4);
+  CHECK(!self.active() && added.active());
+  calls.clear();
+  list->call(5);
+  CHECK(calls == std::vector<int>({50, -5, 52, 54, 105}));
+
+  // Removal from another thread waits for a running callback.
+  std::atomic<bool> running {false}, done {false};
+  Subscription slow = list->add([&] (int arg) {
+      if (arg != 6) return;
+      running = true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      done = true;
+    });
+  std::thread caller([&] () { list->call(6); });
+  waitFor([&] () { return running.load(); });
+  slow.reset();
+  CHECK(done);
+  caller.join();
+
+  // Two consumers, each with a ring of its own fed by one producer, as
+  // for HDSPeTCO::subscribeLtcFrame(): each sees all items, in order.
+  {
+    static const int n = 100000;
+    SubscriberList<std::function<void(const int&)>> producer;
+    RingBuffer<int, 64> rings[2];
+    std::vector<Subscription> consumers;
+    for (auto& ring: rings)
+      consumers.push_back(producer.add([&ring] (const int& item) {
+	    while (!ring.push(item))
+	      std::this_thread::yield();
+	  }));
+    std::thread feeder([&producer] () {
+	for (int i=0; i<n; i++)
+	  producer.call(i);
+      });
+    bool ordered[2] = { true, true };
+    std::vector<std::thread> threads;
+    for (int c=0; c<2; c++)
+      threads.emplace_back([&rings, &ordered, c] () {
+	  for (int i=0; i<n; i++) {
+	    int item;
+	    while (!rings[c].pop(item))
+	      std::this_thread::yield();
+	    ordered[c] = ordered[c] && item == i;
+	  }
+	});
+    feeder.join();
+    for (auto& t: threads)
+      t.join();
+    CHECK(ordered[0] && ordered[1]);
+    CHECK(rings[0].empty() && rings[1].empty());
+  }
+
+  // Subscriptions may outlive the list.
+  list.reset();
+  CHECK(!subs[0].active());
+  subs.clear();
+  added.reset();
+}
+
+//! \brief Start a process that registers rate for serial, and takes
+//! the writer role if it is vacant. It waits until killed. Returns its pid.
+static pid_t startRegistrant(long serial, int rate)
+{
+  int fds[2];
+  if (pipe(fds) < 0)
+    return -1;
+  pid_t child = fork();
+  if (child == 0) {
+    StatusPollRegistry r(serial);
+    r.setRate(rate);
+    r.isWriter();
+    char c = r.available() ? 1 : 0;
+    if (write(fds[1], &c, 1) < 0)
+      _exit(1);
+    for (;;)
+      pause();
+  }
+  char c = 0;
+  if (child < 0 || read(fds[0], &c, 1) != 1 || !c) {
+    if (child > 0) { kill(child, SIGKILL); waitpid(child, nullptr, 0); }
+    child = -1;
+  }
+  close(fds[0]); close(fds[1]);
+  return child;
+}
+
+//! \brief Kill a process started with startRegistrant(): it exits
+//! without unregistering.
+static void killRegistrant(pid_t child)
+{
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+}
+
+//! \brief StatusPollRegistry: writer election, rates, and reclaiming the
+//! slots and writer role of processes that died.
+static void testStatusPollRegistry(void)
+{
+  const long serial = 900000000L + getpid();   // no real card
+  const std::string shmName = "/hdspeconf-poll-" + std::to_string(serial);
+
+  {
+    // Registries with their own open segment behave as separate processes.
+    std::unique_ptr<StatusPollRegistry> a(new StatusPollRegistry(serial));
+    StatusPollRegistry b(serial);
+    CHECK(a->available() && b.available());
+    CHECK(a->isWriter());
+    CHECK(!b.isWriter());
+    a->setRate(2);
+    b.setRate(50);
+    CHECK(a->maxRate() == 50 && b.maxRate() == 50);
+    CHECK(b.writerRate() == 2 && a->writerRate() == 2);
+
+    // Unregistering gives up the writer role.
+    a.reset();
+    CHECK(b.maxRate() == 50);
+    CHECK(b.isWriter());
+    CHECK(b.writerRate() == 50);
+
+    // A process that dies holds neither its slot nor the writer role.
+    pid_t child = startRegistrant(serial, 99);
+    CHECK(child > 0);
+    CHECK(b.maxRate() == 99);
+    killRegistrant(child);
+    CHECK(b.maxRate() == 50);
+
+    b.setRate(0);
+    StatusPollRegistry c(serial);
+    c.setRate(10);
+    CHECK(!c.isWriter() && c.writerRate() == 0);
+    CHECK(b.maxRate() == 10);
+  }
+
+  {
+    // The writer dies: the next process asking takes over, and nobody
+    // counts its rate anymore.
+    pid_t child = startRegistrant(serial, 99);
+    CHECK(child > 0);
+    StatusPollRegistry d(serial);
+    d.setRate(5);
+    CHECK(!d.isWriter());
+    CHECK(d.writerRate() == 99 && d.maxRate() == 99);
+    killRegistrant(child);
+    CHECK(d.writerRate() == 0);
+    CHECK(d.maxRate() == 5);
+    CHECK(d.isWriter() && d.writerRate() == 5);
+  }
+
+  {
+    // A full registry (32 slots) has room again once a process died.
+    std::vector<std::unique_ptr<StatusPollRegistry>> all;
+    for (int i=0; i<31; i++)
+      all.emplace_back(new StatusPollRegistry(serial));
+    pid_t child = startRegistrant(serial, 7);
+    CHECK(child > 0);
+    CHECK(!StatusPollRegistry(serial).available());
+    if (child > 0)
+      killRegistrant(child);
+    CHECK(StatusPollRegistry(serial).available());
+  }
+
+  // The last process to unregister removes the segment, also after
+  // others died.
+  auto exists = [&shmName] () {
+    int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+    if (fd >= 0) close(fd);
+    return fd >= 0;
+  };
+  CHECK(!exists());
+  {
+    std::unique_ptr<StatusPollRegistry> a(new StatusPollRegistry(serial));
+    StatusPollRegistry b(serial);
+    pid_t child = startRegistrant(serial, 3);
+    CHECK(child > 0 && exists());
+    a.reset();
+    CHECK(exists());
+    if (child > 0)
+      killRegistrant(child);
+    CHECK(exists() && b.available());
+  }
+  CHECK(!exists());
+
+  shm_unlink(shmName.c_str());   // if a check failed
+}
+
+//! \brief SndEnumControl: labels from the label table, clamped to the
+//! last item like the driver does.
+static void testSndEnumControl(void)
+{
+  SndSimCard sim("sim:test");
+  sim.addEnum("Test Mode", 2, { "Off", "On", "Auto" });
+  SndCard card("sim:test");
+  SndEnumControl mode(&card, "Test Mode");
+
+  CHECK(mode.getEnumCount() == 3);
+  CHECK(mode.getEnumLabel(0) == "Off" && mode.getEnumLabel(2) == "Auto");
+  CHECK(mode.getEnumLabel(3) == "Auto" && mode.getEnumLabel(~0u) == "Auto");
+  sim.set("Test Mode", { 0, 1 });
+  CHECK(waitFor([&] () { return mode.load(1) == 1; }));
+  CHECK(mode.label(0) == "Off" && mode.label(1) == "On");
+}
+
+//! \brief SndTransaction: all values written, or none, and change
+//! callbacks on the control event handling thread.
+static void testSndTransaction(void)
+{
+  SndSimCard sim("sim:test");
+  sim.addInt("Test A", 1, 0, 100);
+  sim.addInt("Test B", 2, 0, 10);
+  SndCard card("sim:test");
+  SndIntControl a(&card, "Test A"), b(&card, "Test B");
+
+  std::atomic<int> calls {0};
+  std::atomic<bool> onMainThread {false};
+  const std::thread::id main = std::this_thread::get_id();
+  Subscription sub = a.subscribeValueChange([&] () {
+      if (std::this_thread::get_id() == main)
+	onMainThread = true;
+      calls++;
+    });
+
+  // Committed.
+  SndTransaction t;
+  t.set(a, 50);
+  t.set(b, 7, 1);
+  t.commit();
+  CHECK(t.empty());
+  CHECK(sim.get("Test A") == std::vector<long long>({50}));
+  CHECK(sim.get("Test B") == std::vector<long long>({0, 7}));
+  CHECK(waitFor([&] () { return calls > 0; }));
+  CHECK(!onMainThread);
+
+  // The second write fails: the first is rolled back.
+  waitFor([&] () { return a.load(0) == 50; });
+  calls = 0;
+  t.set(a, 60);
+  t.set(b, 20);
+  bool thrown = false;
+  try {
+    t.commit();
+  } catch (std::runtime_error&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK(sim.get("Test A") == std::vector<long long>({50}));
+  CHECK(sim.get("Test B") == std::vector<long long>({0, 7}));
+  CHECK(a.load(0) == 50);
+  CHECK(!onMainThread);
+}
+
+//! \brief SndCoalescingWriter: the last value set is written, and is
+//! pending until then.
+static void testSndCoalescingWriter(void)
+{
+  SndSimCard sim("sim:test");
+  sim.addInt("Test Pitch", 1, 0, 1000);
+  SndCard card("sim:test");
+  SndIntControl pitch(&card, "Test Pitch");
+
+  long v = -1;
+  {
+    // The first value is written right away.
+    SndCoalescingWriter<long> w(pitch, 4.);
+    CHECK(!w.getPending(v) && v == -1);
+    auto start = std::chrono::steady_clock::now();  // before the first write
+    w.set(1);
+    CHECK(waitFor([&] () { return !w.getPending(v); }));
+    CHECK(sim.get("Test Pitch") == std::vector<long long>({1}));
+
+    // Values set within the write period (250 ms) after it stay pending
+    // until the period is over, and only the last one is written. The
+    // pending value is only checked if this thread was not held up for
+    // most of the period.
+    for (long i=2; i<=100; i++)
+      w.set(i);
+    bool pending = w.getPending(v);
+    if (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200))
+      CHECK(pending && v == 100);
+    CHECK(waitFor([&] () { return !w.getPending(v); }));
+    CHECK(sim.get("Test Pitch") == std::vector<long long>({100}));
+
+    // Destroyed right after set(): the value is written still.
+    w.set(200);
+    w.set(300);
+  }
+  CHECK(sim.get("Test Pitch") == std::vector<long long>({300}));
+}
+
+static const struct {
+  const char* name;
+  void (*run)(void);
+} tests[] = {
+  { "SampleRate", testSampleRate },
+  { "RingBuffer", testRingBuffer },
+  { "SubscriberList", testSubscriberList },
+  { "StatusPollRegistry", testStatusPollRegistry },
+  { "SndEnumControl", testSndEnumControl },
+  { "SndTransaction", testSndTransaction },
+  { "SndCoalescingWriter", testSndCoalescingWriter },
+};
+
+int main(int argc, char** argv)
+{
+  for (int i=1; i<argc; i++) {
+    bool known = false;
+    for (auto& t: tests)
+      known = known || t.name == std::string(argv[i]);
+    if (!known) {
+      std::cerr << "Usage: " << argv[0] << " [<test>...]\n";
+      return 1;
+    }
+  }
+
+  int ran = 0;
+  for (auto& t: tests) {
+    bool selected = argc < 2;
+    for (int i=1; i<argc; i++)
+      if (t.name == std::string(argv[i]))
+	selected = true;
+    if (!selected)
+      continue;
+    int before = failures;
+    t.run();
+    ran++;
+    std::cout << t.name << (failures == before ? " : ok\n" : " : FAILED\n");
+  }
+  std::cout << ran << " test(s), " << checks << " checks, " << failures << " failed\n";
+  return failures ? 1 : 0;
+}